@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Monotonic clock in nanoseconds. */
+static inline uint64_t bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* xorshift64, deterministic so that every run measures the same inputs. */
+static inline uint64_t bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/* Keep the optimizer from discarding results that are otherwise unused. */
+static inline void bench_sink(const void *p) { __asm__ __volatile__("" : : "r"(p) : "memory"); }
+
+#define BENCH_SAMPLES 5
+
+/* Timing of one benchmark case, in nanoseconds per operation. */
+typedef struct benchStats {
+    double min_ns;
+    double median_ns;
+    uint64_t ops; /* Operations per sample. */
+} benchStats;
+
+static int bench_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Run fn(arg), which performs 'ops_per_call' operations, long enough for a
+ * sample to take at least 'min_sample_ns', and return the best and median of
+ * BENCH_SAMPLES samples. */
+static inline benchStats bench_measure(void (*fn)(void *), void *arg, uint64_t ops_per_call, uint64_t min_sample_ns) {
+    double samples[BENCH_SAMPLES];
+    uint64_t calls = 1, elapsed;
+    benchStats stats;
+
+    /* Calibrate, this also warms up caches and branch predictors. */
+    for (;;) {
+        uint64_t start = bench_ns();
+        for (uint64_t i = 0; i < calls; i++) fn(arg);
+        elapsed = bench_ns() - start;
+        if (elapsed >= min_sample_ns || calls >= (1ULL << 40)) break;
+        calls *= 2;
+    }
+
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        uint64_t start = bench_ns();
+        for (uint64_t i = 0; i < calls; i++) fn(arg);
+        samples[s] = (double)(bench_ns() - start) / (double)(calls * ops_per_call);
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(double), bench_cmp_double);
+    stats.min_ns = samples[0];
+    stats.median_ns = samples[BENCH_SAMPLES / 2];
+    stats.ops = calls * ops_per_call;
+    return stats;
+}
+
+/* Machine readable output: one JSON document per run, shaped as
+ * {"suite": ..., "compiler": ..., "results": [{...}, ...]}. */
+static inline void bench_json_begin(FILE *fp, const char *suite) {
+    fprintf(fp, "{\n  \"suite\": \"%s\",\n  \"timestamp\": %ld,\n", suite, (long)time(NULL));
+#ifdef __VERSION__
+    fprintf(fp, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+#ifdef BENCH_BUILD_TYPE
+    fprintf(fp, "  \"build_type\": \"%s\",\n", BENCH_BUILD_TYPE);
+#endif
+    fprintf(fp, "  \"results\": [");
+}
+
+static inline void bench_json_result(FILE *fp, int *first, const char *function, const char *dataset, size_t inputs,
+                                     benchStats stats) {
+    fprintf(fp,
+            "%s\n    {\"function\": \"%s\", \"dataset\": \"%s\", \"inputs\": %zu, \"ops\": %llu, "
+            "\"ns_per_op_min\": %.2f, \"ns_per_op_median\": %.2f, \"ops_per_sec\": %.0f}",
+            *first ? "" : ",", function, dataset, inputs, (unsigned long long)stats.ops, stats.min_ns, stats.median_ns,
+            stats.min_ns > 0 ? 1e9 / stats.min_ns : 0.0);
+    *first = 0;
+}
+
+static inline void bench_json_end(FILE *fp) { fprintf(fp, "\n  ]\n}\n"); }
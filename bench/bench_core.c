@@ -0,0 +1,181 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* In-process benchmark of tairstring_core, driven through the RedisModule
+ * shim. With --check it only runs a few sanity checks of the core decisions
+ * and exits non-zero if any of them fails. */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "redismodule_shim.h"
+#include "tairstring_core.h"
+#include "util.h"
+
+#define EXSET_ALLOW                                                                                          \
+    (TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | \
+     TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_SET_WITH_FLAGS | \
+     TAIR_STRING_RETURN_WITH_VER)
+#define EXINCRBY_ALLOW                                                                                       \
+    (TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | \
+     TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_RETURN_WITH_VER | \
+     TAIR_STRING_SET_WITH_DEF | TAIR_STRING_SET_NONEGATIVE | TAIR_STRING_SET_WITH_BOUNDARY)
+
+static int failed = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failed = 1;                                                      \
+        }                                                                    \
+    } while (0)
+
+static int parse_line(const char *line, int start, unsigned int allow, int *ex_flags) {
+    struct RedisModuleString *expire_p = NULL, *version_p = NULL, *flags_p = NULL, *def_p = NULL, *min_p = NULL,
+                             *max_p = NULL;
+    int argc, ret;
+    struct RedisModuleString **argv = shimSplitArgv(line, &argc);
+    ret = parseAndGetExFlags(argv, argc, start, ex_flags, &expire_p, &version_p, &flags_p, &def_p, &min_p, &max_p,
+                             allow);
+    shimFreeArgv(argv, argc);
+    return ret;
+}
+
+static int counted_options_end(const char *line, int start) {
+    int argc, end;
+    struct RedisModuleString **argv = shimSplitArgv(line, &argc);
+    end = tairStringCountedOptionsEnd(argv, argc, start);
+    shimFreeArgv(argv, argc);
+    return end;
+}
+
+static int check(void) {
+    int ex_flags = 0;
+    long long ll;
+    long double ld;
+    long long min = 0, max = 100;
+    char buf[MAX_LONG_DOUBLE_CHARS];
+
+    CHECK(parse_line("EXSET k v EX 10 VER 3 WITHVERSION", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_OK);
+    CHECK(ex_flags == (TAIR_STRING_SET_EX | TAIR_STRING_SET_WITH_VER | TAIR_STRING_RETURN_WITH_VER));
+    CHECK(parse_line("EXSET k v pxat 10 abs 3", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_OK);
+    CHECK(ex_flags == (TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_WITH_ABS_VER));
+    CHECK(parse_line("EXSET k v NX XX", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_ERR);
+    CHECK(parse_line("EXSET k v EX 1 KEEPTTL", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_ERR);
+    CHECK(parse_line("EXSET k v MIN 1", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_ERR);
+    CHECK(parse_line("EXSET k v EX", 3, EXSET_ALLOW, &ex_flags) == REDISMODULE_ERR);
+    CHECK(counted_options_end("EXMSET k1 v1 4 EX 10 VER 2 k2 v2 0", 3) == 8);
+    CHECK(counted_options_end("EXMSET ex ver 0 ver ex 0", 3) == 4);
+    CHECK(counted_options_end("EXMSET k1 v1 0", 3) == 4);
+    CHECK(counted_options_end("EXMSET k1 v1 3 EX 10", 3) == -1);
+    CHECK(counted_options_end("EXMSET k1 v1 -1", 3) == -1);
+    CHECK(counted_options_end("EXMSET k1 v1 EX 10", 3) == -1);
+    CHECK(counted_options_end("EXMSET k1 v1", 3) == -1);
+
+    CHECK(tairStringVersionMatches(0, 7, 3));
+    CHECK(tairStringVersionMatches(TAIR_STRING_SET_WITH_VER, 0, 3));
+    CHECK(tairStringVersionMatches(TAIR_STRING_SET_WITH_VER, 3, 3));
+    CHECK(!tairStringVersionMatches(TAIR_STRING_SET_WITH_VER, 2, 3));
+    CHECK(tairStringNextVersion(TAIR_STRING_SET_WITH_VER, 3, 3) == 4);
+    CHECK(tairStringNextVersion(TAIR_STRING_SET_WITH_ABS_VER, 100, 3) == 100);
+
+    CHECK(tairStringRelativeExpire(TAIR_STRING_SET_EX, 10, 5000) == 10000);
+    CHECK(tairStringRelativeExpire(TAIR_STRING_SET_PX, 10, 5000) == 10);
+    CHECK(tairStringRelativeExpire(TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE, 6000, 5000) == 1000);
+    CHECK(tairStringRelativeExpire(TAIR_STRING_SET_EX | TAIR_STRING_SET_ABS_EXPIRE, 4, 5000) == 0);
+
+    CHECK(tairStringIncrBy(1, 2, NULL, NULL, &ll) == REDISMODULE_OK && ll == 3);
+    CHECK(tairStringIncrBy(LLONG_MAX, 1, NULL, NULL, &ll) == REDISMODULE_ERR);
+    CHECK(tairStringIncrBy(LLONG_MIN, -1, NULL, NULL, &ll) == REDISMODULE_ERR);
+    CHECK(tairStringIncrBy(99, 1, &min, &max, &ll) == REDISMODULE_OK && ll == 100);
+    CHECK(tairStringIncrBy(99, 2, &min, &max, &ll) == REDISMODULE_ERR);
+    CHECK(tairStringIncrBy(0, -1, &min, &max, &ll) == REDISMODULE_ERR);
+
+    CHECK(tairStringIncrByFloat(10.5L, 0.1L, NULL, NULL, &ld) == REDISMODULE_OK);
+    CHECK(tairStringEncodeFloat(buf, sizeof(buf), ld) == 4 && !strcmp(buf, "10.6"));
+    CHECK(tairStringIncrByFloat(1.0L, 1.0L / 0.0L, NULL, NULL, &ld) == REDISMODULE_ERR);
+    return failed;
+}
+
+#define TIME_LOOP(label, iters, expr)                                           \
+    do {                                                                        \
+        uint64_t start = bench_ns();                                            \
+        for (long i = 0; i < (iters); i++) {                                    \
+            expr;                                                               \
+        }                                                                       \
+        double ns = (double)(bench_ns() - start) / (double)(iters);             \
+        printf("%-40s %10.1f ns/op\n", label, ns);                              \
+    } while (0)
+
+int main(int argc, char **argv) {
+    long iters = 2000000;
+
+    shimInit();
+    if (argc > 1 && !strcmp(argv[1], "--check")) {
+        return check();
+    }
+    if (argc > 1) iters = atol(argv[1]);
+
+    int set_argc, incr_argc, ex_flags = 0;
+    struct RedisModuleString **set_argv = shimSplitArgv("EXSET key value EX 3600 VER 12 FLAGS 3 WITHVERSION", &set_argc);
+    struct RedisModuleString **incr_argv =
+        shimSplitArgv("EXINCRBY key 1 DEF 0 MIN 0 MAX 1000000 NONEGATIVE WITHVERSION", &incr_argc);
+    struct RedisModuleString *expire_p, *version_p, *flags_p, *def_p, *min_p, *max_p;
+    long long ll = 0, min = 0, max = LLONG_MAX;
+    long double ld = 0;
+    char buf[MAX_LONG_DOUBLE_CHARS];
+    uint64_t seed = 1;
+
+    TIME_LOOP("parseAndGetExFlags EXSET", iters, {
+        expire_p = version_p = flags_p = NULL;
+        parseAndGetExFlags(set_argv, set_argc, 3, &ex_flags, &expire_p, &version_p, &flags_p, NULL, NULL, NULL,
+                           EXSET_ALLOW);
+        bench_sink(version_p);
+    });
+    TIME_LOOP("parseAndGetExFlags EXINCRBY", iters, {
+        expire_p = version_p = def_p = min_p = max_p = NULL;
+        parseAndGetExFlags(incr_argv, incr_argc, 3, &ex_flags, &expire_p, &version_p, NULL, &def_p, &min_p, &max_p,
+                           EXINCRBY_ALLOW);
+        bench_sink(max_p);
+    });
+    TIME_LOOP("version check + next version", iters, {
+        uint64_t cur = bench_rand(&seed) & 0xff;
+        if (tairStringVersionMatches(TAIR_STRING_SET_WITH_VER, (long long)cur, cur))
+            ll += (long long)tairStringNextVersion(TAIR_STRING_SET_WITH_VER, (long long)cur, cur);
+        bench_sink(&ll);
+    });
+    TIME_LOOP("tairStringRelativeExpire", iters, {
+        ll += tairStringRelativeExpire(TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE, (long long)i, 1000);
+        bench_sink(&ll);
+    });
+    TIME_LOOP("tairStringIncrBy with bounds", iters, {
+        if (tairStringIncrBy(ll & 0xffff, 1, &min, &max, &ll) != REDISMODULE_OK) ll = 0;
+        bench_sink(&ll);
+    });
+    TIME_LOOP("tairStringIncrByFloat + encode", iters, {
+        tairStringIncrByFloat(ld, 0.25L, NULL, NULL, &ld);
+        tairStringEncodeFloat(buf, sizeof(buf), ld);
+        bench_sink(buf);
+    });
+
+    shimFreeArgv(set_argv, set_argc);
+    shimFreeArgv(incr_argv, incr_argc);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Compare m_ld2string() against the snprintf() based path it replaced. With
+ * --check it only verifies that the humanfriendly long double output is
+ * byte-identical to the old one, and exits non-zero otherwise. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "util.h"
+
+#define NVALUES 4096
+
+/* The m_ld2string() humanfriendly path before the fixed-point rewrite. */
+static int legacy_ld2string(char *buf, size_t len, long double value) {
+    size_t l = snprintf(buf, len, "%.17Lf", value);
+    if (l + 1 > len) return 0;
+    if (strchr(buf, '.') != NULL) {
+        char *p = buf + l - 1;
+        while (*p == '0') {
+            p--;
+            l--;
+        }
+        if (*p == '.') l--;
+    }
+    buf[l] = '\0';
+    return l;
+}
+
+/* Values an EXINCRBYFLOAT counter typically goes through: running sums of
+ * small decimal increments, a few large balances and some tiny rates. */
+static void fill_values(long double *ld, uint64_t seed) {
+    uint64_t s = seed;
+    long double acc = 0;
+    for (int i = 0; i < NVALUES; i++) {
+        switch (bench_rand(&s) % 4) {
+            case 0:
+                acc += (long double)(bench_rand(&s) % 1000) / 10;
+                ld[i] = acc;
+                break;
+            case 1:
+                ld[i] = (long double)(int64_t)(bench_rand(&s) % 2000000 - 1000000) / 100;
+                break;
+            case 2:
+                ld[i] = (long double)(bench_rand(&s) % 1000000000000ULL) + 0.5L;
+                break;
+            default:
+                ld[i] = ldexpl((long double)(bench_rand(&s) >> 11), -60);
+                break;
+        }
+    }
+}
+
+static int check(const long double *ld) {
+    char a[MAX_LONG_DOUBLE_CHARS], b[MAX_LONG_DOUBLE_CHARS];
+    int failed = 0;
+    for (int i = 0; i < NVALUES; i++) {
+        int la = m_ld2string(a, sizeof(a), ld[i], 1);
+        int lb = legacy_ld2string(b, sizeof(b), ld[i]);
+        if (la != lb || memcmp(a, b, la) != 0) {
+            fprintf(stderr, "m_ld2string mismatch for %La: '%s' != '%s'\n", ld[i], a, b);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+#define TIME_LOOP(label, rounds, expr)                                                 \
+    do {                                                                               \
+        uint64_t start = bench_ns();                                                   \
+        for (int r = 0; r < (rounds); r++) {                                           \
+            for (int i = 0; i < NVALUES; i++) {                                        \
+                expr;                                                                  \
+                bench_sink(buf);                                                       \
+            }                                                                          \
+        }                                                                              \
+        double ns = (double)(bench_ns() - start) / ((double)(rounds) * NVALUES);       \
+        printf("%-32s %10.1f ns/op\n", label, ns);                                     \
+    } while (0)
+
+int main(int argc, char **argv) {
+    static long double ld[NVALUES];
+    char buf[MAX_LONG_DOUBLE_CHARS];
+    int rounds = 200;
+
+    fill_values(ld, 0x9e3779b97f4a7c15ULL);
+    if (argc > 1 && !strcmp(argv[1], "--check")) {
+        return check(ld);
+    }
+    if (argc > 1) rounds = atoi(argv[1]);
+
+    TIME_LOOP("ld2string humanfriendly legacy", rounds, legacy_ld2string(buf, sizeof(buf), ld[i]));
+    TIME_LOOP("ld2string humanfriendly", rounds, m_ld2string(buf, sizeof(buf), ld[i], 1));
+    return 0;
+}
@@ -0,0 +1,491 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Correctness and throughput of parseAndGetExFlags over a corpus of argument
+ * vectors, driven through the RedisModule shim.
+ *
+ * The corpus has two parts:
+ *   - parser_corpus.txt, the option lists of the commands in
+ *     tests/tairstring.tcl, each with the expected parse result;
+ *   - every sequence of up to three options (NX, XX, EX, EXAT, PX, PXAT, VER,
+ *     ABS, FLAGS, DEF, MIN, MAX, KEEPTTL, GET, ...) for every command that uses the
+ *     parser, optionally followed by an option missing its argument. These
+ *     are checked against the table driven model of the option grammar below.
+ *
+ * Usage: bench_parser [--check] [--print] [--quick] [--max-ns <ns>]
+ *                     [--baseline <file> [--tolerance <percent>]] [-o <file>] [<corpus>]
+ *   --check      only check the results, exit non-zero on a mismatch;
+ *   --print      print the corpus with the results of the current parser, to
+ *                regenerate it after an intended change of the grammar;
+ *   --quick      short samples;
+ *   --max-ns     exit non-zero if a dataset takes more than <ns> per parse;
+ *   --baseline   exit non-zero if a dataset is more than <percent> (default
+ *                20) slower than in <file>, a previous JSON output;
+ *   -o           write the JSON document to <file> instead of stdout. */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "bench.h"
+#include "redismodule_shim.h"
+#include "tairstring_core.h"
+
+#define MAX_LINE 1024
+
+/* Arguments captured by the parser. */
+enum { SLOT_EXPIRE, SLOT_VERSION, SLOT_FLAGS, SLOT_DEF, SLOT_MIN, SLOT_MAX, SLOT_COUNT, SLOT_NONE = -1 };
+
+static const char *slot_names[SLOT_COUNT] = {"expire", "version", "flags", "def", "min", "max"};
+
+/* How a command calls parseAndGetExFlags: where the options start, which
+ * arguments it captures and which flags it accepts. */
+typedef struct parserProfile {
+    const char *command;
+    const char *prefix; /* The arguments before the options. */
+    int start;
+    unsigned int slots;
+    unsigned int allow;
+} parserProfile;
+
+#define SLOT(s) (1u << (s))
+#define EXPIRE_FLAGS (TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE)
+#define COND_FLAGS (TAIR_STRING_SET_NX | TAIR_STRING_SET_XX)
+#define VERSION_FLAGS (TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER)
+
+static const parserProfile profiles[] = {
+    {"EXSET", "k v", 3, SLOT(SLOT_EXPIRE) | SLOT(SLOT_VERSION) | SLOT(SLOT_FLAGS),
+     COND_FLAGS | EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL | VERSION_FLAGS | TAIR_STRING_SET_WITH_FLAGS |
+         TAIR_STRING_RETURN_WITH_VER | TAIR_STRING_SET_GET},
+    {"EXINCRBY", "k 1", 3,
+     SLOT(SLOT_EXPIRE) | SLOT(SLOT_VERSION) | SLOT(SLOT_DEF) | SLOT(SLOT_MIN) | SLOT(SLOT_MAX),
+     COND_FLAGS | EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL | VERSION_FLAGS | TAIR_STRING_RETURN_WITH_VER |
+         TAIR_STRING_SET_WITH_DEF | TAIR_STRING_SET_NONEGATIVE | TAIR_STRING_SET_WITH_BOUNDARY},
+    {"EXINCRBYFLOAT", "k 1.5", 3, SLOT(SLOT_EXPIRE) | SLOT(SLOT_VERSION) | SLOT(SLOT_MIN) | SLOT(SLOT_MAX),
+     COND_FLAGS | EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL | VERSION_FLAGS | TAIR_STRING_SET_WITH_BOUNDARY},
+    {"EXCAS", "k v 1", 4, SLOT(SLOT_EXPIRE), EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL},
+    {"CAS", "k old new", 4, SLOT(SLOT_EXPIRE), EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL},
+    {"EXAPPEND", "k v", 3, SLOT(SLOT_VERSION), COND_FLAGS | VERSION_FLAGS},
+    {"EXPREPEND", "k v", 3, SLOT(SLOT_VERSION), COND_FLAGS | VERSION_FLAGS},
+    {"EXSETRANGE", "k 0 v", 4, SLOT(SLOT_VERSION), COND_FLAGS | VERSION_FLAGS},
+    {"EXGAE", "k", 2, SLOT(SLOT_EXPIRE), EXPIRE_FLAGS},
+    {"EXUPBEGIN", "up", 2, SLOT(SLOT_EXPIRE), EXPIRE_FLAGS},
+    {"EXUPCOMMIT", "up k", 3, SLOT(SLOT_EXPIRE) | SLOT(SLOT_VERSION) | SLOT(SLOT_FLAGS),
+     COND_FLAGS | EXPIRE_FLAGS | TAIR_STRING_SET_KEEPTTL | VERSION_FLAGS | TAIR_STRING_SET_WITH_FLAGS},
+};
+
+#define NPROFILES (sizeof(profiles) / sizeof(profiles[0]))
+
+static const parserProfile *find_profile(const char *command) {
+    for (size_t j = 0; j < NPROFILES; j++) {
+        if (!strcasecmp(profiles[j].command, command)) return &profiles[j];
+    }
+    return NULL;
+}
+
+/* The option grammar, as a table: an option taking an argument is an error
+ * when its argument was already captured, or when it is missing or not
+ * captured by the command (then the option is an unknown token). */
+typedef struct optionSpec {
+    const char *name;
+    int slot;
+    unsigned int sets;
+    unsigned int conflicts; /* Flags it cannot follow. */
+} optionSpec;
+
+static const optionSpec options[] = {
+    {"NX", SLOT_NONE, TAIR_STRING_SET_NX, TAIR_STRING_SET_XX},
+    {"XX", SLOT_NONE, TAIR_STRING_SET_XX, TAIR_STRING_SET_NX},
+    {"EX", SLOT_EXPIRE, TAIR_STRING_SET_EX, TAIR_STRING_SET_KEEPTTL},
+    {"EXAT", SLOT_EXPIRE, TAIR_STRING_SET_EX | TAIR_STRING_SET_ABS_EXPIRE, TAIR_STRING_SET_KEEPTTL},
+    {"PX", SLOT_EXPIRE, TAIR_STRING_SET_PX, TAIR_STRING_SET_KEEPTTL},
+    {"PXAT", SLOT_EXPIRE, TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE, TAIR_STRING_SET_KEEPTTL},
+    {"VER", SLOT_VERSION, TAIR_STRING_SET_WITH_VER, 0},
+    {"ABS", SLOT_VERSION, TAIR_STRING_SET_WITH_ABS_VER, 0},
+    {"FLAGS", SLOT_FLAGS, TAIR_STRING_SET_WITH_FLAGS, 0},
+    {"DEF", SLOT_DEF, TAIR_STRING_SET_WITH_DEF, 0},
+    {"MIN", SLOT_MIN, TAIR_STRING_SET_WITH_BOUNDARY, 0},
+    {"MAX", SLOT_MAX, TAIR_STRING_SET_WITH_BOUNDARY, 0},
+    {"NONEGATIVE", SLOT_NONE, TAIR_STRING_SET_NONEGATIVE, 0},
+    {"WITHVERSION", SLOT_NONE, TAIR_STRING_RETURN_WITH_VER, 0},
+    {"KEEPTTL", SLOT_NONE, TAIR_STRING_SET_KEEPTTL, TAIR_STRING_SET_EX | TAIR_STRING_SET_PX},
+    {"GET", SLOT_NONE, TAIR_STRING_SET_GET, 0},
+};
+
+static const char *flag_names[] = {"NX",        "XX",           "EX",         "PX",        "ABS_EXPIRE",
+                                   "WITH_VER",  "WITH_ABS_VER", "BOUNDARY",   "FLAGS",     "DEF",
+                                   "NONEGATIVE", "WITHVERSION", "KEEPTTL",  "GET"};
+
+#define NFLAGS (sizeof(flag_names) / sizeof(flag_names[0]))
+
+/* A parse result, 'args' holds the argv index of each captured argument or
+ * -1. */
+typedef struct parseResult {
+    int ok;
+    int ex_flags;
+    int args[SLOT_COUNT];
+} parseResult;
+
+static int results_equal(const parseResult *a, const parseResult *b) {
+    if (a->ok != b->ok) return 0;
+    if (!a->ok) return 1;
+    return a->ex_flags == b->ex_flags && !memcmp(a->args, b->args, sizeof(a->args));
+}
+
+static parseResult model_parse(const parserProfile *p, const char **argv, int argc) {
+    parseResult r = {0, 0, {-1, -1, -1, -1, -1, -1}};
+
+    for (int j = p->start; j < argc; j++) {
+        const optionSpec *o = NULL;
+        for (size_t k = 0; k < sizeof(options) / sizeof(options[0]); k++) {
+            if (!strcasecmp(options[k].name, argv[j])) o = &options[k];
+        }
+        if (o && o->slot != SLOT_NONE && (!(p->slots & SLOT(o->slot)) || j == argc - 1)) o = NULL;
+        if (!o) return r;
+        if (r.ex_flags & o->conflicts) return r;
+        if (o->slot != SLOT_NONE) {
+            if (r.args[o->slot] != -1) return r;
+            r.args[o->slot] = ++j;
+        }
+        r.ex_flags |= o->sets;
+    }
+    r.ok = !(r.ex_flags & ~p->allow);
+    return r;
+}
+
+static parseResult real_parse(const parserProfile *p, struct RedisModuleString **argv, int argc) {
+    struct RedisModuleString *captured[SLOT_COUNT] = {NULL};
+    struct RedisModuleString **ptr[SLOT_COUNT];
+    parseResult r = {0, 0, {-1, -1, -1, -1, -1, -1}};
+
+    for (int s = 0; s < SLOT_COUNT; s++) ptr[s] = (p->slots & SLOT(s)) ? &captured[s] : NULL;
+    r.ok = parseAndGetExFlags(argv, argc, p->start, &r.ex_flags, ptr[SLOT_EXPIRE], ptr[SLOT_VERSION],
+                              ptr[SLOT_FLAGS], ptr[SLOT_DEF], ptr[SLOT_MIN], ptr[SLOT_MAX],
+                              p->allow) == REDISMODULE_OK;
+    for (int s = 0; s < SLOT_COUNT; s++) {
+        for (int j = 0; j < argc && captured[s]; j++) {
+            if (argv[j] == captured[s]) r.args[s] = j;
+        }
+    }
+    return r;
+}
+
+/* "ok EX,WITH_VER expire=10 version=3", or "err". */
+static void format_result(char *buf, size_t len, const parseResult *r, char **words) {
+    size_t n = 0;
+
+    if (!r->ok) {
+        snprintf(buf, len, "err");
+        return;
+    }
+    n += snprintf(buf + n, len - n, "ok ");
+    if (!r->ex_flags) n += snprintf(buf + n, len - n, "-");
+    for (size_t f = 0, sep = 0; f < NFLAGS && n < len; f++) {
+        if (r->ex_flags & (1 << f)) n += snprintf(buf + n, len - n, "%s%s", sep++ ? "," : "", flag_names[f]);
+    }
+    for (int s = 0; s < SLOT_COUNT && n < len; s++) {
+        if (r->args[s] != -1) n += snprintf(buf + n, len - n, " %s=%s", slot_names[s], words[r->args[s]]);
+    }
+}
+
+/* A parser input, split both into C strings for the model and into shim
+ * strings for the parser. */
+typedef struct parserCase {
+    const parserProfile *profile;
+    int argc;
+    char **words;
+    struct RedisModuleString **argv;
+    char *expected; /* Corpus cases only. */
+} parserCase;
+
+typedef struct caseList {
+    const char *name;
+    parserCase *cases;
+    size_t n, cap;
+} caseList;
+
+static char **split_words(const char *line, int *argc) {
+    char **words = NULL;
+    int n = 0;
+    while (*line) {
+        while (isspace((unsigned char)*line)) line++;
+        if (!*line) break;
+        const char *start = line;
+        while (*line && !isspace((unsigned char)*line)) line++;
+        words = realloc(words, sizeof(*words) * (n + 1));
+        words[n++] = strndup(start, line - start);
+    }
+    *argc = n;
+    return words;
+}
+
+static int add_case(caseList *l, const char *line, const char *expected) {
+    parserCase c;
+
+    c.words = split_words(line, &c.argc);
+    c.profile = c.argc ? find_profile(c.words[0]) : NULL;
+    if (!c.profile) {
+        for (int j = 0; j < c.argc; j++) free(c.words[j]);
+        free(c.words);
+        return -1;
+    }
+    c.argv = shimSplitArgv(line, &c.argc);
+    c.expected = expected ? strdup(expected) : NULL;
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 256;
+        l->cases = realloc(l->cases, sizeof(*l->cases) * l->cap);
+    }
+    l->cases[l->n++] = c;
+    return 0;
+}
+
+static void free_cases(caseList *l) {
+    for (size_t j = 0; j < l->n; j++) {
+        for (int k = 0; k < l->cases[j].argc; k++) free(l->cases[j].words[k]);
+        free(l->cases[j].words);
+        shimFreeArgv(l->cases[j].argv, l->cases[j].argc);
+        free(l->cases[j].expected);
+    }
+    free(l->cases);
+}
+
+static void trim(char *s) {
+    size_t n = strlen(s);
+    while (n && isspace((unsigned char)s[n - 1])) s[--n] = '\0';
+}
+
+/* Corpus lines are "<argv> => <expected result>", '#' starts a comment. With
+ * 'print' set the corpus is copied to stdout with the results of the
+ * current parser. */
+static int load_corpus(caseList *l, const char *path, int print) {
+    char line[MAX_LINE], result[MAX_LINE];
+    int lineno = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *sep = strstr(line, "=>");
+        lineno++;
+        trim(line);
+        if (!sep || line[0] == '#') {
+            if (print) printf("%s\n", line);
+            continue;
+        }
+        *sep = '\0';
+        sep += 2;
+        while (isspace((unsigned char)*sep)) sep++;
+        if (add_case(l, line, sep) == -1) {
+            fprintf(stderr, "%s:%d: unknown command\n", path, lineno);
+            fclose(fp);
+            return -1;
+        }
+        if (print) {
+            parserCase *c = &l->cases[l->n - 1];
+            parseResult r = real_parse(c->profile, c->argv, c->argc);
+            format_result(result, sizeof(result), &r, c->words);
+            trim(line);
+            printf("%s => %s\n", line, result);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* Options for the generated permutations; some arguments are option names,
+ * and the second option of a sequence is written in lower case. */
+static const char *perm_options[] = {"NX",    "XX",    "EX 10", "EXAT 10", "PX 10",      "PXAT NX",
+                                     "VER 1", "ABS 1", "FLAGS 1", "DEF -1", "MIN 0",     "MAX 100",
+                                     "KEEPTTL", "NONEGATIVE", "WITHVERSION", "GET",     "BOGUS"};
+static const char *dangling[] = {"EX", "EXAT", "PX", "PXAT", "VER", "ABS", "FLAGS", "DEF", "MIN", "MAX"};
+
+#define NPERM (sizeof(perm_options) / sizeof(perm_options[0]))
+#define NDANGLING (sizeof(dangling) / sizeof(dangling[0]))
+
+static void lower(char *s) {
+    for (; *s; s++) *s = tolower((unsigned char)*s);
+}
+
+static void generate_permutations(caseList *l) {
+    char line[MAX_LINE], opt[64];
+
+    for (size_t p = 0; p < NPROFILES; p++) {
+        for (int len = 0; len <= 3; len++) {
+            size_t total = 1;
+            for (int k = 0; k < len; k++) total *= NPERM;
+            for (size_t seq = 0; seq < total; seq++) {
+                /* d == 0: no dangling option, sequences of three get none. */
+                for (size_t d = 0; d <= (len < 3 ? NDANGLING : 0); d++) {
+                    size_t rest = seq;
+                    int n = snprintf(line, sizeof(line), "%s %s", profiles[p].command, profiles[p].prefix);
+                    for (int k = 0; k < len; k++, rest /= NPERM) {
+                        snprintf(opt, sizeof(opt), "%s", perm_options[rest % NPERM]);
+                        if (k == 1) lower(opt);
+                        n += snprintf(line + n, sizeof(line) - n, " %s", opt);
+                    }
+                    if (d) snprintf(line + n, sizeof(line) - n, " %s", dangling[d - 1]);
+                    add_case(l, line, NULL);
+                }
+            }
+        }
+    }
+}
+
+static int check_cases(const caseList *l) {
+    char expected[MAX_LINE], actual[MAX_LINE];
+    size_t failures = 0;
+
+    for (size_t j = 0; j < l->n; j++) {
+        const parserCase *c = &l->cases[j];
+        parseResult real = real_parse(c->profile, c->argv, c->argc);
+        int mismatch;
+
+        format_result(actual, sizeof(actual), &real, c->words);
+        if (c->expected) {
+            snprintf(expected, sizeof(expected), "%s", c->expected);
+            mismatch = strcmp(expected, actual) != 0;
+        } else {
+            parseResult model = model_parse(c->profile, (const char **)c->words, c->argc);
+            format_result(expected, sizeof(expected), &model, c->words);
+            mismatch = !results_equal(&model, &real);
+        }
+        if (mismatch && failures++ < 20) {
+            fprintf(stderr, "%s:", l->name);
+            for (int k = 0; k < c->argc; k++) fprintf(stderr, " %s", c->words[k]);
+            fprintf(stderr, "\n    expected: %s\n    actual:   %s\n", expected, actual);
+        }
+    }
+    if (failures) fprintf(stderr, "%s: %zu of %zu cases failed\n", l->name, failures, l->n);
+    return failures != 0;
+}
+
+static void run_cases(void *arg) {
+    const caseList *l = arg;
+    struct RedisModuleString *expire_p, *version_p, *flags_p, *def_p, *min_p, *max_p;
+    int ex_flags;
+
+    for (size_t j = 0; j < l->n; j++) {
+        const parserCase *c = &l->cases[j];
+        const parserProfile *p = c->profile;
+        expire_p = version_p = flags_p = def_p = min_p = max_p = NULL;
+        parseAndGetExFlags(c->argv, c->argc, p->start, &ex_flags, (p->slots & SLOT(SLOT_EXPIRE)) ? &expire_p : NULL,
+                           (p->slots & SLOT(SLOT_VERSION)) ? &version_p : NULL,
+                           (p->slots & SLOT(SLOT_FLAGS)) ? &flags_p : NULL,
+                           (p->slots & SLOT(SLOT_DEF)) ? &def_p : NULL, (p->slots & SLOT(SLOT_MIN)) ? &min_p : NULL,
+                           (p->slots & SLOT(SLOT_MAX)) ? &max_p : NULL, p->allow);
+        bench_sink(&ex_flags);
+    }
+}
+
+/* ns_per_op_median of a dataset in a previous JSON output, or -1. */
+static double baseline_ns(const char *path, const char *dataset) {
+    char line[MAX_LINE], key[128];
+    double ns = -1;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) return -1;
+    snprintf(key, sizeof(key), "\"dataset\": \"%s\"", dataset);
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = strstr(line, "\"ns_per_op_median\": ");
+        if (strstr(line, key) && p) ns = atof(p + strlen("\"ns_per_op_median\": "));
+    }
+    fclose(fp);
+    return ns;
+}
+
+#define USAGE                                                                                              \
+    "Usage: %s [--check] [--print] [--quick] [--max-ns <ns>] [--baseline <file> [--tolerance <percent>]] " \
+    "[-o <file>] [<corpus>]\n"
+
+int main(int argc, char **argv) {
+    const char *corpus = "bench/parser_corpus.txt", *baseline = NULL;
+    int check = 0, print = 0, first = 1, failed = 0;
+    double max_ns = 0, tolerance = 20;
+    uint64_t min_sample_ns = 100 * 1000 * 1000;
+    FILE *fp = stdout;
+
+    for (int j = 1; j < argc; j++) {
+        if (!strcmp(argv[j], "--check")) {
+            check = 1;
+        } else if (!strcmp(argv[j], "--print")) {
+            print = 1;
+        } else if (!strcmp(argv[j], "--quick")) {
+            min_sample_ns = 1000 * 1000;
+        } else if (!strcmp(argv[j], "--max-ns") && j + 1 < argc) {
+            max_ns = atof(argv[++j]);
+        } else if (!strcmp(argv[j], "--baseline") && j + 1 < argc) {
+            baseline = argv[++j];
+        } else if (!strcmp(argv[j], "--tolerance") && j + 1 < argc) {
+            tolerance = atof(argv[++j]);
+        } else if (!strcmp(argv[j], "-o") && j + 1 < argc) {
+            fp = fopen(argv[++j], "w");
+            if (!fp) {
+                perror(argv[j]);
+                return 1;
+            }
+        } else if (argv[j][0] != '-') {
+            corpus = argv[j];
+        } else {
+            fprintf(stderr, USAGE, argv[0]);
+            return 1;
+        }
+    }
+
+    shimInit();
+    caseList corpus_cases = {"corpus", NULL, 0, 0}, perm_cases = {"permutations", NULL, 0, 0};
+    if (load_corpus(&corpus_cases, corpus, print) == -1) return 1;
+    if (print) {
+        free_cases(&corpus_cases);
+        return 0;
+    }
+    generate_permutations(&perm_cases);
+
+    failed |= check_cases(&corpus_cases);
+    failed |= check_cases(&perm_cases);
+    if (check || failed) {
+        free_cases(&corpus_cases);
+        free_cases(&perm_cases);
+        return failed;
+    }
+
+    caseList *lists[] = {&corpus_cases, &perm_cases};
+    bench_json_begin(fp, "parser");
+    for (size_t j = 0; j < sizeof(lists) / sizeof(lists[0]); j++) {
+        benchStats stats = bench_measure(run_cases, lists[j], lists[j]->n, min_sample_ns);
+        bench_json_result(fp, &first, "parseAndGetExFlags", lists[j]->name, lists[j]->n, stats);
+        fflush(fp);
+        if (max_ns > 0 && stats.median_ns > max_ns) {
+            fprintf(stderr, "%s: %.1f ns/parse, above the %.1f ns limit\n", lists[j]->name, stats.median_ns, max_ns);
+            failed = 1;
+        }
+        double base = baseline ? baseline_ns(baseline, lists[j]->name) : -1;
+        if (base > 0 && stats.median_ns > base * (1 + tolerance / 100)) {
+            fprintf(stderr, "%s: %.1f ns/parse, %.0f%% slower than the %.1f ns baseline\n", lists[j]->name,
+                    stats.median_ns, (stats.median_ns / base - 1) * 100, base);
+            failed = 1;
+        }
+    }
+    bench_json_end(fp);
+    if (fp != stdout) fclose(fp);
+
+    free_cases(&corpus_cases);
+    free_cases(&perm_cases);
+    return failed;
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Benchmark every function exported by dep/util.h on the inputs the commands
+ * actually feed them, and print the results as one JSON document so that runs
+ * can be archived and compared over time.
+ *
+ * Usage: bench_util [--quick] [--filter <function>] [-o <file>]
+ *   --quick   short samples, only meant to keep the benchmark from rotting;
+ *   --filter  only run the cases of functions whose name contains <function>;
+ *   -o        write the JSON document to <file> instead of stdout. */
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "util.h"
+
+#define NINPUTS 1024
+#define MAX_INPUT_LEN 64
+
+/* A dataset: NINPUTS strings and, for the numeric ones, the values they
+ * encode. */
+typedef struct dataset {
+    const char *name;
+    int n;
+    char str[NINPUTS][MAX_INPUT_LEN];
+    size_t len[NINPUTS];
+    long long ll[NINPUTS];
+    long double ld[NINPUTS];
+    double d[NINPUTS];
+} dataset;
+
+/* A glob pattern and the keys it is matched against. */
+typedef struct globCase {
+    const char *name;
+    const char *pattern;
+    int nocase;
+    dataset *keys;
+} globCase;
+
+static uint64_t seed = 0x9e3779b97f4a7c15ULL;
+
+static void add_ll(dataset *ds, long long v) {
+    ds->ll[ds->n] = v;
+    ds->len[ds->n] = m_ll2string(ds->str[ds->n], MAX_INPUT_LEN, v);
+    ds->n++;
+}
+
+static void add_str(dataset *ds, const char *s) {
+    ds->len[ds->n] = snprintf(ds->str[ds->n], MAX_INPUT_LEN, "%s", s);
+    ds->n++;
+}
+
+/* EXINCRBY counters: page views, retries, quotas. Mostly small. */
+static void fill_short_counters(dataset *ds) {
+    ds->name = "short_counters";
+    while (ds->n < NINPUTS) {
+        uint64_t r = bench_rand(&seed);
+        add_ll(ds, (long long)(r % 8 == 0 ? r % 1000000 : r % 1000));
+    }
+}
+
+static void fill_negative(dataset *ds) {
+    ds->name = "negative";
+    while (ds->n < NINPUTS) add_ll(ds, -(long long)(bench_rand(&seed) % 10000000) - 1);
+}
+
+/* Full width values: ids, nanosecond timestamps, bit sets. */
+static void fill_19_digits(dataset *ds) {
+    ds->name = "19_digits";
+    add_ll(ds, LLONG_MAX);
+    add_ll(ds, LLONG_MIN);
+    while (ds->n < NINPUTS) {
+        long long v = (long long)(1000000000000000000ULL + bench_rand(&seed) % (LLONG_MAX - 1000000000000000000ULL));
+        add_ll(ds, ds->n % 2 ? v : -v);
+    }
+}
+
+/* Strings m_string2ll() must reject, usually on the first few bytes: values
+ * of a string key hit by INCR, leading zeros, overflows. */
+static void fill_invalid_integers(dataset *ds) {
+    static const char *samples[] = {"hello", "12a", "007", "+1", " 1", "1.5", "", "-", "99999999999999999999",
+                                    "-9223372036854775809"};
+    ds->name = "invalid";
+    while (ds->n < NINPUTS) add_str(ds, samples[ds->n % (sizeof(samples) / sizeof(samples[0]))]);
+}
+
+/* EXINCRBYFLOAT values: money, ratios, sums of decimal increments, and an
+ * exponent now and then. */
+static void fill_floats(dataset *ds) {
+    long double acc = 0;
+    ds->name = "floats";
+    while (ds->n < NINPUTS) {
+        uint64_t r = bench_rand(&seed);
+        long double v;
+        switch (r % 5) {
+            case 0:
+                acc += (long double)(bench_rand(&seed) % 1000) / 10;
+                v = acc;
+                break;
+            case 1:
+                v = (long double)(int64_t)(bench_rand(&seed) % 2000000 - 1000000) / 100;
+                break;
+            case 2:
+                v = (long double)(bench_rand(&seed) % 1000000);
+                break;
+            case 3:
+                v = ldexpl((long double)(bench_rand(&seed) >> 11), -60);
+                break;
+            default:
+                v = (long double)(bench_rand(&seed) % 1000) * powl(10, (int)(bench_rand(&seed) % 40) - 20);
+                break;
+        }
+        ds->ld[ds->n] = v;
+        ds->d[ds->n] = (double)v;
+        if (r % 5 == 4) {
+            ds->len[ds->n] = snprintf(ds->str[ds->n], MAX_INPUT_LEN, "%.6Le", v);
+        } else {
+            ds->len[ds->n] = m_ld2string(ds->str[ds->n], MAX_INPUT_LEN, v, 1);
+        }
+        ds->n++;
+    }
+}
+
+/* Doubles with an integral value, which m_d2string() formats as integers. */
+static void fill_integral_doubles(dataset *ds) {
+    ds->name = "integral";
+    while (ds->n < NINPUTS) {
+        ds->d[ds->n] = (double)(int64_t)(bench_rand(&seed) % 2000000 - 1000000);
+        ds->n++;
+    }
+}
+
+/* Any finite double, uniformly over the bit patterns. */
+static void fill_random_doubles(dataset *ds) {
+    ds->name = "random_bits";
+    while (ds->n < NINPUTS) {
+        uint64_t bits = bench_rand(&seed);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (!isfinite(d)) continue;
+        ds->d[ds->n] = d;
+        ds->ld[ds->n] = d;
+        ds->n++;
+    }
+}
+
+/* Memory sizes, as found in configuration: plain bytes and unit suffixes. */
+static void fill_memory_sizes(dataset *ds) {
+    static const char *units[] = {"", "b", "k", "kb", "m", "mb", "g", "gb", "MB", "Gb"};
+    ds->name = "sizes";
+    while (ds->n < NINPUTS) {
+        uint64_t r = bench_rand(&seed);
+        ds->len[ds->n] = snprintf(ds->str[ds->n], MAX_INPUT_LEN, "%llu%s", (unsigned long long)(r % 4096),
+                                  units[(r >> 32) % (sizeof(units) / sizeof(units[0]))]);
+        ds->n++;
+    }
+}
+
+/* Keys of a typical keyspace, the subjects of KEYS/SCAN MATCH patterns. */
+static void fill_keys(dataset *ds) {
+    static const char *prefixes[] = {"user:", "session:", "USER:", "lock:order:", "cache:page:"};
+    ds->name = "keys";
+    while (ds->n < NINPUTS) {
+        uint64_t r = bench_rand(&seed);
+        ds->len[ds->n] = snprintf(ds->str[ds->n], MAX_INPUT_LEN, "%s%llu%s",
+                                  prefixes[r % (sizeof(prefixes) / sizeof(prefixes[0]))],
+                                  (unsigned long long)((r >> 8) % 1000000), (r >> 40) % 4 ? "" : ":profile");
+        ds->n++;
+    }
+}
+
+/* The worst case of the backtracking matcher: every star may absorb any
+ * number of 'a', and the trailing 'b' never matches. A match costs about a
+ * millisecond, so only a handful of subjects. */
+static void fill_pathological(dataset *ds) {
+    ds->name = "pathological";
+    while (ds->n < 8) {
+        ds->len[ds->n] = 20 + ds->n % 4;
+        memset(ds->str[ds->n], 'a', ds->len[ds->n]);
+        ds->str[ds->n][ds->len[ds->n]] = '\0';
+        ds->n++;
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * One function per benchmarked call, each processes a whole dataset.
+ * ------------------------------------------------------------------------ */
+
+static void run_string2ll(void *arg) {
+    dataset *ds = arg;
+    long long v, sum = 0;
+    for (int i = 0; i < ds->n; i++) {
+        if (m_string2ll(ds->str[i], ds->len[i], &v)) sum += v;
+    }
+    bench_sink(&sum);
+}
+
+static void run_ll2string(void *arg) {
+    dataset *ds = arg;
+    char buf[32];
+    for (int i = 0; i < ds->n; i++) {
+        m_ll2string(buf, sizeof(buf), ds->ll[i]);
+        bench_sink(buf);
+    }
+}
+
+static void run_string2ld(void *arg) {
+    dataset *ds = arg;
+    long double v, sum = 0;
+    for (int i = 0; i < ds->n; i++) {
+        if (m_string2ld(ds->str[i], ds->len[i], &v)) sum += v;
+    }
+    bench_sink(&sum);
+}
+
+static void run_ld2string_human(void *arg) {
+    dataset *ds = arg;
+    char buf[MAX_LONG_DOUBLE_CHARS];
+    for (int i = 0; i < ds->n; i++) {
+        m_ld2string(buf, sizeof(buf), ds->ld[i], 1);
+        bench_sink(buf);
+    }
+}
+
+static void run_ld2string_exp(void *arg) {
+    dataset *ds = arg;
+    char buf[MAX_LONG_DOUBLE_CHARS];
+    for (int i = 0; i < ds->n; i++) {
+        m_ld2string(buf, sizeof(buf), ds->ld[i], 0);
+        bench_sink(buf);
+    }
+}
+
+static void run_d2string(void *arg) {
+    dataset *ds = arg;
+    char buf[128];
+    for (int i = 0; i < ds->n; i++) {
+        m_d2string(buf, sizeof(buf), ds->d[i]);
+        bench_sink(buf);
+    }
+}
+
+static void run_memtoll(void *arg) {
+    dataset *ds = arg;
+    long long sum = 0;
+    int err;
+    for (int i = 0; i < ds->n; i++) sum += m_memtoll(ds->str[i], &err);
+    bench_sink(&sum);
+}
+
+static void run_stringmatchlen(void *arg) {
+    globCase *gc = arg;
+    int plen = strlen(gc->pattern), matches = 0;
+    for (int i = 0; i < gc->keys->n; i++) {
+        matches += m_stringmatchlen(gc->pattern, plen, gc->keys->str[i], gc->keys->len[i], gc->nocase);
+    }
+    bench_sink(&matches);
+}
+
+static const char *filter = NULL;
+static uint64_t min_sample_ns = 50 * 1000 * 1000;
+static int first = 1;
+
+static void bench(FILE *fp, const char *function, const char *dataset_name, void (*fn)(void *), void *arg, int n) {
+    if (filter && !strstr(function, filter)) return;
+    bench_json_result(fp, &first, function, dataset_name, n, bench_measure(fn, arg, n, min_sample_ns));
+    fflush(fp);
+}
+
+int main(int argc, char **argv) {
+    static dataset short_counters, negative, digits19, invalid, floats, integral, random_bits, sizes, keys,
+        pathological;
+    FILE *fp = stdout;
+
+    for (int j = 1; j < argc; j++) {
+        if (!strcmp(argv[j], "--quick")) {
+            min_sample_ns = 1000 * 1000;
+        } else if (!strcmp(argv[j], "--filter") && j + 1 < argc) {
+            filter = argv[++j];
+        } else if (!strcmp(argv[j], "-o") && j + 1 < argc) {
+            fp = fopen(argv[++j], "w");
+            if (!fp) {
+                perror(argv[j]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--quick] [--filter <function>] [-o <file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    fill_short_counters(&short_counters);
+    fill_negative(&negative);
+    fill_19_digits(&digits19);
+    fill_invalid_integers(&invalid);
+    fill_floats(&floats);
+    fill_integral_doubles(&integral);
+    fill_random_doubles(&random_bits);
+    fill_memory_sizes(&sizes);
+    fill_keys(&keys);
+    fill_pathological(&pathological);
+
+    dataset *integers[] = {&short_counters, &negative, &digits19};
+    globCase globs[] = {
+        {"prefix", "user:*", 0, &keys},
+        {"infix", "*:profile*", 0, &keys},
+        {"charclass", "user:[0-9][0-9]*", 0, &keys},
+        {"nocase", "user:*", 1, &keys},
+        {"question_marks", "user:??????", 0, &keys},
+        {"pathological", "*a*a*a*a*a*b", 0, &pathological},
+    };
+
+    bench_json_begin(fp, "util");
+    for (size_t j = 0; j < sizeof(integers) / sizeof(integers[0]); j++) {
+        bench(fp, "m_string2ll", integers[j]->name, run_string2ll, integers[j], integers[j]->n);
+    }
+    bench(fp, "m_string2ll", invalid.name, run_string2ll, &invalid, invalid.n);
+    for (size_t j = 0; j < sizeof(integers) / sizeof(integers[0]); j++) {
+        bench(fp, "m_ll2string", integers[j]->name, run_ll2string, integers[j], integers[j]->n);
+    }
+    bench(fp, "m_string2ld", short_counters.name, run_string2ld, &short_counters, short_counters.n);
+    bench(fp, "m_string2ld", digits19.name, run_string2ld, &digits19, digits19.n);
+    bench(fp, "m_string2ld", floats.name, run_string2ld, &floats, floats.n);
+    bench(fp, "m_ld2string_humanfriendly", floats.name, run_ld2string_human, &floats, floats.n);
+    bench(fp, "m_ld2string_humanfriendly", random_bits.name, run_ld2string_human, &random_bits, random_bits.n);
+    bench(fp, "m_ld2string", floats.name, run_ld2string_exp, &floats, floats.n);
+    bench(fp, "m_d2string", integral.name, run_d2string, &integral, integral.n);
+    bench(fp, "m_d2string", floats.name, run_d2string, &floats, floats.n);
+    bench(fp, "m_d2string", random_bits.name, run_d2string, &random_bits, random_bits.n);
+    bench(fp, "m_memtoll", sizes.name, run_memtoll, &sizes, sizes.n);
+    for (size_t j = 0; j < sizeof(globs) / sizeof(globs[0]); j++) {
+        bench(fp, "m_stringmatchlen", globs[j].name, run_stringmatchlen, &globs[j], globs[j].keys->n);
+    }
+    bench_json_end(fp);
+
+    if (fp != stdout) fclose(fp);
+    return 0;
+}
@@ -0,0 +1,70 @@
+# Helpers shared by the server benchmarks in bench/, sourced after ROOT and
+# WORK are set. Tools can be overridden with REDIS_SERVER and REDIS_CLI.
+
+REDIS_SERVER=${REDIS_SERVER:-redis-server}
+REDIS_CLI=${REDIS_CLI:-redis-cli}
+
+die() {
+    echo "$(basename "$0"): $*" >&2
+    exit 1
+}
+
+require() { # <tool...>
+    local tool
+    for tool in "$@"; do
+        command -v "$tool" >/dev/null 2>&1 || die "$tool not found"
+    done
+}
+
+now_ns() { date +%s%N; }
+
+# Configure and build the tree into <dir>, quietly.
+build() { # <dir> <cmake args...>
+    local dir=$1
+    shift
+    cmake -S "$ROOT" -B "$dir" -DCMAKE_BUILD_TYPE=Release -DTAIRSTRING_OUTPUT_DIR="$dir/lib" "$@" >/dev/null
+    cmake --build "$dir" -j"$(nproc)" >/dev/null
+}
+
+cli() { # <port> <args...>
+    local port=$1
+    shift
+    "$REDIS_CLI" -p "$port" "$@"
+}
+
+# Wait until the server answers PING, which it does not while loading.
+wait_ready() { # <port>
+    local _
+    for _ in $(seq 1 6000); do
+        [ "$(cli "$1" ping 2>/dev/null)" = "PONG" ] && return 0
+        sleep 0.05
+    done
+    die "redis-server on port $1 is not ready, see $WORK/redis-$1.log"
+}
+
+# Start a server with the module loaded, without persistence unless the
+# extra arguments ask for it.
+start_server() { # <port> <module> [redis-server args...]
+    local port=$1 module=$2
+    shift 2
+    "$REDIS_SERVER" --port "$port" --save "" --appendonly no --daemonize yes \
+        --logfile "$WORK/redis-$port.log" --dir "$WORK" --loadmodule "$module" "$@" >/dev/null
+    wait_ready "$port"
+}
+
+stop_server() { # <port>
+    cli "$1" shutdown nosave >/dev/null 2>&1 || true
+    while cli "$1" ping >/dev/null 2>&1; do sleep 0.1; done
+}
+
+# INFO field, e.g. info_field 6399 memory used_memory
+info_field() { # <port> <section> <field>
+    cli "$1" info "$2" | tr -d '\r' | awk -F: -v f="$3" '$1 == f { print $2 }'
+}
+
+# DEBUG is disabled by default since redis 7.
+debug_args() {
+    local major
+    major=$("$REDIS_SERVER" --version | sed -n 's/.*v=\([0-9]*\)\..*/\1/p')
+    if [ "${major:-0}" -ge 7 ]; then echo "--enable-debug-command yes"; fi
+}
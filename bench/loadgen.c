@@ -0,0 +1,1353 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Load generator for the TairString commands.
+ *
+ * redis-benchmark only replays fixed commands. Here every connection keeps up
+ * to --pipeline operations in flight, and an operation may take several round
+ * trips, the way real clients use the module:
+ *
+ *   excas      EXGET, then EXCAS with the version read. On CAS_FAILED retry
+ *              with the version the reply carries, create with EXSET NX if
+ *              the key does not exist.
+ *   exset_ver  EXGET, then EXSET ... VER <version>, re-read on a stale version.
+ *   excad      EXGET, then EXCAD with the version read.
+ *   cas, cad   the same with GET + CAS/CAD on native strings.
+ *   exlock     a lock: acquire with EXSET NX EX, hold, renew with EXGAE,
+ *              release with EXCAD. A held lock is retried after a backoff.
+ *   lock       the same with SET NX EX, CAS (renew) and CAD on native strings.
+ *
+ * Keys are drawn uniformly or from a zipf distribution (--zipf), values from
+ * a size distribution (-s). The report gives, per operation, the
+ * throughput, retries and conflicts, and the latency percentiles of the whole
+ * operation (retries included) as well as of single requests. For locks it
+ * adds the acquisition latency, the round trips wasted on held locks, and the
+ * fairness between connections (Jain's index of acquisitions per connection).
+ *
+ * Run with --help for the options. */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/* ========================== Configuration ========================== */
+
+enum {
+    OP_EXSET,
+    OP_EXSET_EX,
+    OP_EXSET_VER,
+    OP_EXGET,
+    OP_EXINCRBY,
+    OP_EXINCRBYFLOAT,
+    OP_EXCAS,
+    OP_EXCAD,
+    OP_EXGAE,
+    OP_EXAPPEND,
+    OP_EXPREPEND,
+    OP_SET,
+    OP_GET,
+    OP_CAS,
+    OP_CAD,
+    OP_EXLOCK,
+    OP_LOCK,
+    OP_COUNT
+};
+
+/* Commands on different value kinds use different key prefixes, so that a
+ * mix never trips over WRONGTYPE or "not an integer". */
+static const struct {
+    const char *name;
+    const char *prefix;
+} ops[OP_COUNT] = {
+    [OP_EXSET] = {"exset", "ex:"},          [OP_EXSET_EX] = {"exset_ex", "ex:"},
+    [OP_EXSET_VER] = {"exset_ver", "ex:"},  [OP_EXGET] = {"exget", "ex:"},
+    [OP_EXINCRBY] = {"exincrby", "cnt:"},   [OP_EXINCRBYFLOAT] = {"exincrbyfloat", "flt:"},
+    [OP_EXCAS] = {"excas", "ex:"},          [OP_EXCAD] = {"excad", "ex:"},
+    [OP_EXGAE] = {"exgae", "ex:"},          [OP_EXAPPEND] = {"exappend", "ex:"},
+    [OP_EXPREPEND] = {"exprepend", "ex:"},  [OP_SET] = {"set", "str:"},
+    [OP_GET] = {"get", "str:"},             [OP_CAS] = {"cas", "str:"},
+    [OP_CAD] = {"cad", "str:"},             [OP_EXLOCK] = {"exlock", "exlock:"},
+    [OP_LOCK] = {"lock", "lock:"},
+};
+
+static int is_lock(int op) { return op == OP_EXLOCK || op == OP_LOCK; }
+
+#define MAX_SIZE_CLASSES 16
+
+static struct config {
+    const char *host;
+    int port;
+    const char *auth;
+    int threads;
+    int connections;
+    int pipeline;
+    uint64_t requests; /* Operations, 0 when running for 'duration'. */
+    double duration;
+    uint64_t keyspace;
+    double zipf; /* 0 is uniform. */
+    int max_retries;
+    long long incr_max;
+    int lock_ttl;          /* Seconds. */
+    double lock_hold_ms;   /* Time spent holding the lock, between renewals. */
+    int lock_renewals;
+    double lock_backoff_ms;
+    int populate;
+    int json;
+    uint64_t seed;
+    /* Operation mix, weight of each operation. */
+    unsigned weight[OP_COUNT];
+    unsigned total_weight;
+    /* Value sizes: either a range [size_min, size_max] or weighted classes. */
+    int size_classes;
+    size_t size[MAX_SIZE_CLASSES];
+    unsigned size_weight[MAX_SIZE_CLASSES];
+    unsigned size_total_weight;
+    size_t size_min, size_max;
+} cfg = {
+    .host = "127.0.0.1",
+    .port = 6379,
+    .threads = 1,
+    .connections = 50,
+    .pipeline = 1,
+    .requests = 100000,
+    .keyspace = 100000,
+    .max_retries = 16,
+    .incr_max = 1000000000,
+    .lock_ttl = 10,
+    .lock_hold_ms = 1,
+    .lock_backoff_ms = 1,
+    .seed = 0x9e3779b97f4a7c15ULL,
+    .size_min = 64,
+    .size_max = 64,
+};
+
+/* ========================== Latency histogram ========================== */
+
+/* Log-linear buckets over nanoseconds: exact below 64, then 32 buckets per
+ * power of two, i.e. about 3% resolution up to minutes. */
+#define HIST_SUB 32
+#define HIST_BUCKETS (2 * HIST_SUB + 58 * HIST_SUB)
+
+typedef struct histogram {
+    uint64_t count;
+    uint64_t max;
+    uint64_t bucket[HIST_BUCKETS];
+} histogram;
+
+static int hist_index(uint64_t v) {
+    if (v < 2 * HIST_SUB) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - 5; /* v >> shift is in [HIST_SUB, 2 * HIST_SUB). */
+    int idx = 2 * HIST_SUB + (shift - 1) * HIST_SUB + (int)((v >> shift) - HIST_SUB);
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+/* Upper bound of the values counted in bucket 'idx'. */
+static uint64_t hist_value(int idx) {
+    if (idx < 2 * HIST_SUB) return (uint64_t)idx;
+    int shift = (idx - 2 * HIST_SUB) / HIST_SUB + 1;
+    uint64_t base = (uint64_t)(HIST_SUB + (idx - 2 * HIST_SUB) % HIST_SUB);
+    return ((base + 1) << shift) - 1;
+}
+
+static void hist_add(histogram *h, uint64_t v) {
+    h->bucket[hist_index(v)]++;
+    h->count++;
+    if (v > h->max) h->max = v;
+}
+
+static void hist_merge(histogram *dst, const histogram *src) {
+    for (int j = 0; j < HIST_BUCKETS; j++) dst->bucket[j] += src->bucket[j];
+    dst->count += src->count;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+static double hist_percentile_us(const histogram *h, double p) {
+    if (!h->count) return 0;
+    uint64_t rank = (uint64_t)ceil(p / 100 * (double)h->count), seen = 0;
+    if (rank == 0) rank = 1;
+    for (int j = 0; j < HIST_BUCKETS; j++) {
+        seen += h->bucket[j];
+        if (seen >= rank) {
+            uint64_t v = hist_value(j);
+            return (double)(v < h->max ? v : h->max) / 1000;
+        }
+    }
+    return (double)h->max / 1000;
+}
+
+/* ========================== Key and value distributions ========================== */
+
+/* Rejection-inversion sampling of a zipf distribution over [1, n], see
+ * W. Hormann, G. Derflinger, "Rejection-inversion to generate variates from
+ * monotone discrete distributions". O(1) per sample and no table, so the
+ * keyspace can be as large as needed. */
+typedef struct zipfGen {
+    double s;
+    uint64_t n;
+    double h_x1, h_n, threshold;
+} zipfGen;
+
+static double zipf_helper1(double x) { return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x)); }
+static double zipf_helper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+}
+static double zipf_h(const zipfGen *z, double x) { return exp(-z->s * log(x)); }
+static double zipf_H(const zipfGen *z, double x) {
+    double lx = log(x);
+    return zipf_helper2((1 - z->s) * lx) * lx;
+}
+static double zipf_H_inv(const zipfGen *z, double x) {
+    double t = x * (1 - z->s);
+    if (t < -1) t = -1;
+    return exp(zipf_helper1(t) * x);
+}
+
+static void zipf_init(zipfGen *z, uint64_t n, double s) {
+    z->s = s;
+    z->n = n;
+    z->h_x1 = zipf_H(z, 1.5) - 1;
+    z->h_n = zipf_H(z, (double)n + 0.5);
+    z->threshold = 2 - zipf_H_inv(z, zipf_H(z, 2.5) - zipf_h(z, 2));
+}
+
+static double rand01(uint64_t *seed) { return (double)(bench_rand(seed) >> 11) / (double)(1ULL << 53); }
+
+/* Returns a rank in [0, n), rank 0 being the hottest key. */
+static uint64_t zipf_next(const zipfGen *z, uint64_t *seed) {
+    for (;;) {
+        double u = z->h_n + rand01(seed) * (z->h_x1 - z->h_n);
+        double x = zipf_H_inv(z, u);
+        uint64_t k = (uint64_t)(x + 0.5);
+        if (k < 1) k = 1;
+        if (k > z->n) k = z->n;
+        if ((double)k - x <= z->threshold || u >= zipf_H(z, (double)k + 0.5) - zipf_h(z, (double)k)) return k - 1;
+    }
+}
+
+static zipfGen zipf;
+static char *value_pool;
+static size_t value_pool_len;
+
+static uint64_t next_key(uint64_t *seed) {
+    if (cfg.zipf > 0) return zipf_next(&zipf, seed);
+    return bench_rand(seed) % cfg.keyspace;
+}
+
+static size_t next_value_size(uint64_t *seed) {
+    if (cfg.size_classes) {
+        unsigned r = (unsigned)(bench_rand(seed) % cfg.size_total_weight);
+        for (int j = 0; j < cfg.size_classes; j++) {
+            if (r < cfg.size_weight[j]) return cfg.size[j];
+            r -= cfg.size_weight[j];
+        }
+    }
+    if (cfg.size_max == cfg.size_min) return cfg.size_min;
+    return cfg.size_min + bench_rand(seed) % (cfg.size_max - cfg.size_min + 1);
+}
+
+/* A value is a window of a random printable pool, so that consecutive writes
+ * of the same key differ without generating bytes on the hot path. */
+static const char *next_value(uint64_t *seed, size_t *len) {
+    *len = next_value_size(seed);
+    return value_pool + bench_rand(seed) % (value_pool_len - *len + 1);
+}
+
+/* ========================== RESP ========================== */
+
+/* Top level reply, with the first elements of an array reply: that is all
+ * the TairString replies need. Strings point into the read buffer. */
+#define REPLY_ELEMENTS 3
+
+typedef struct respValue {
+    char type; /* '+', '-', ':', '$', '*', or 0 for a null bulk/array. */
+    long long integer;
+    const char *str;
+    size_t len;
+} respValue;
+
+typedef struct respReply {
+    respValue top;
+    int elements;
+    respValue element[REPLY_ELEMENTS];
+} respReply;
+
+/* Parse one value at buf[0..len). Returns the bytes consumed, 0 if the reply
+ * is not complete yet, -1 on protocol errors. Array elements are stored into
+ * 'reply' when 'depth' is 0 and skipped otherwise. */
+static long resp_parse_value(const char *buf, size_t len, respValue *v, respReply *reply, int depth) {
+    const char *nl = memchr(buf, '\n', len);
+    long long n;
+    char *end;
+
+    if (!nl) return 0;
+    if (nl == buf || nl[-1] != '\r') return -1;
+    v->type = buf[0];
+    v->str = buf + 1;
+    v->len = nl - 1 - (buf + 1);
+    size_t used = nl + 1 - buf;
+
+    switch (buf[0]) {
+        case '+':
+        case '-':
+            return used;
+        case ':':
+            v->integer = strtoll(buf + 1, &end, 10);
+            return used;
+        case '$':
+            n = strtoll(buf + 1, &end, 10);
+            if (n < 0) {
+                v->type = 0;
+                return used;
+            }
+            if (len < used + n + 2) return 0;
+            v->str = buf + used;
+            v->len = n;
+            return used + n + 2;
+        case '*':
+            n = strtoll(buf + 1, &end, 10);
+            v->integer = n;
+            if (n < 0) {
+                v->type = 0;
+                return used;
+            }
+            if (reply && depth == 0) reply->elements = (int)n;
+            for (long long j = 0; j < n; j++) {
+                respValue tmp;
+                respValue *e = (reply && depth == 0 && j < REPLY_ELEMENTS) ? &reply->element[j] : &tmp;
+                long l = resp_parse_value(buf + used, len - used, e, reply, depth + 1);
+                if (l <= 0) return l;
+                used += l;
+            }
+            return used;
+        default:
+            return -1;
+    }
+}
+
+static long resp_parse(const char *buf, size_t len, respReply *reply) {
+    reply->elements = 0;
+    return resp_parse_value(buf, len, &reply->top, reply, 0);
+}
+
+typedef struct buffer {
+    char *buf;
+    size_t len, cap, pos; /* 'pos' is how much was already written or parsed. */
+} buffer;
+
+static void buf_reserve(buffer *b, size_t extra) {
+    if (b->len + extra <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 16384;
+    while (cap < b->len + extra) cap *= 2;
+    b->buf = realloc(b->buf, cap);
+    if (!b->buf) {
+        perror("realloc");
+        exit(1);
+    }
+    b->cap = cap;
+}
+
+static void buf_append(buffer *b, const char *p, size_t len) {
+    buf_reserve(b, len);
+    memcpy(b->buf + b->len, p, len);
+    b->len += len;
+}
+
+/* Drop what was consumed, keeping the unconsumed tail at the start. */
+static void buf_compact(buffer *b) {
+    if (b->pos == 0) return;
+    memmove(b->buf, b->buf + b->pos, b->len - b->pos);
+    b->len -= b->pos;
+    b->pos = 0;
+}
+
+typedef struct arg {
+    const char *p;
+    size_t len;
+} arg;
+
+#define ARG(s) ((arg){(s), strlen(s)})
+
+static void resp_command(buffer *b, int argc, const arg *argv) {
+    char hdr[32];
+    buf_append(b, hdr, snprintf(hdr, sizeof(hdr), "*%d\r\n", argc));
+    for (int j = 0; j < argc; j++) {
+        buf_append(b, hdr, snprintf(hdr, sizeof(hdr), "$%zu\r\n", argv[j].len));
+        buf_append(b, argv[j].p, argv[j].len);
+        buf_append(b, "\r\n", 2);
+    }
+}
+
+static int connect_server(void) {
+    struct addrinfo hints = {0}, *res, *ai;
+    char port[16];
+    int fd = -1, one = 1, rv;
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", cfg.port);
+    if ((rv = getaddrinfo(cfg.host, port, &hints, &res)) != 0) {
+        fprintf(stderr, "loadgen: %s: %s\n", cfg.host, gai_strerror(rv));
+        exit(1);
+    }
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd == -1) {
+        fprintf(stderr, "loadgen: cannot connect to %s:%d: %s\n", cfg.host, cfg.port, strerror(errno));
+        exit(1);
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/* Blocking request/response, for AUTH and --populate. Sends everything in
+ * 'out', then reads 'expected' replies, failing on error replies. */
+static void sync_exchange(int fd, buffer *out, buffer *in, uint64_t expected) {
+    respReply r;
+    while (out->pos < out->len) {
+        ssize_t n = write(fd, out->buf + out->pos, out->len - out->pos);
+        if (n <= 0) {
+            perror("loadgen: write");
+            exit(1);
+        }
+        out->pos += n;
+    }
+    out->len = out->pos = 0;
+    while (expected) {
+        long l;
+        while (expected && (l = resp_parse(in->buf + in->pos, in->len - in->pos, &r)) > 0) {
+            if (r.top.type == '-') {
+                fprintf(stderr, "loadgen: %.*s\n", (int)r.top.len, r.top.str);
+                exit(1);
+            }
+            in->pos += l;
+            expected--;
+        }
+        if (!expected) break;
+        if (l < 0) {
+            fprintf(stderr, "loadgen: protocol error\n");
+            exit(1);
+        }
+        buf_compact(in);
+        buf_reserve(in, 16384);
+        ssize_t n = read(fd, in->buf + in->len, in->cap - in->len);
+        if (n <= 0) {
+            fprintf(stderr, "loadgen: connection lost\n");
+            exit(1);
+        }
+        in->len += n;
+    }
+    buf_compact(in);
+}
+
+/* ========================== Operations ========================== */
+
+/* Steps of the multi round trip operations. */
+enum { STEP_SINGLE, STEP_READ, STEP_WRITE, STEP_CREATE, STEP_ACQUIRE, STEP_RENEW, STEP_RELEASE };
+
+/* handle_reply() results. */
+#define OP_DONE 0
+#define OP_NEXT 1  /* The next request is queued. */
+#define OP_SLEEP 2 /* The next request is due at 'wake_at'. */
+
+typedef struct opStats {
+    uint64_t ops;       /* Completed operations. */
+    uint64_t requests;  /* Round trips they took. */
+    uint64_t retries;   /* Writes repeated after a version or value mismatch, lock attempts on a held lock. */
+    uint64_t conflicts; /* Operations that gave up: deleted or changed under us, too many retries, lock lost. */
+    uint64_t misses;    /* Reads and conditional writes that found no key. */
+    uint64_t rejected;  /* EXINCRBY/EXINCRBYFLOAT beyond MIN/MAX. */
+    uint64_t errors;
+    histogram op_latency;
+    histogram req_latency;
+    histogram acquire_latency; /* Locks: from the first attempt to the acquisition. */
+} opStats;
+
+typedef struct inflight {
+    int op;
+    int step;
+    int attempts;
+    uint64_t key;
+    uint64_t op_start;
+    uint64_t req_start;
+    char *old; /* cas/cad: the value read, locks: the token. */
+    size_t old_len;
+    long long version; /* exlock: the version returned by the acquisition. */
+    int renewals;
+    uint64_t wake_at;
+} inflight;
+
+typedef struct conn {
+    int fd;
+    buffer out, in;
+    inflight *queue; /* Ring of 'pipeline' entries, in reply order. */
+    int head, count;
+    inflight *sleeping; /* Operations waiting for 'wake_at', they keep their pipeline slot. */
+    int nsleeping;
+    uint64_t acquired; /* Locks acquired, for fairness. */
+} conn;
+
+typedef struct worker {
+    pthread_t tid;
+    conn *conns;
+    int nconns;
+    uint64_t seed;
+    uint64_t quota; /* Operations this worker may start, 0 for no limit. */
+    uint64_t started;
+    uint64_t bytes_sent;
+    uint64_t deadline;
+    opStats stats[OP_COUNT];
+} worker;
+
+static int pick_op(worker *w) {
+    unsigned r = (unsigned)(bench_rand(&w->seed) % cfg.total_weight);
+    for (int j = 0; j < OP_COUNT; j++) {
+        if (r < cfg.weight[j]) return j;
+        r -= cfg.weight[j];
+    }
+    return OP_COUNT - 1;
+}
+
+static arg key_arg(char *buf, size_t size, int op, uint64_t key) {
+    return (arg){buf, (size_t)snprintf(buf, size, "%s%llu", ops[op].prefix, (unsigned long long)key)};
+}
+
+static void send_lock_step(conn *c, inflight *f, arg k) {
+    char ttlbuf[32], verbuf[32];
+    arg token = {f->old, f->old_len};
+    arg ttl = {ttlbuf, (size_t)snprintf(ttlbuf, sizeof(ttlbuf), "%d", cfg.lock_ttl)};
+    int native = f->op == OP_LOCK;
+
+    if (f->step == STEP_ACQUIRE && native) {
+        arg argv[] = {ARG("SET"), k, token, ARG("NX"), ARG("EX"), ttl};
+        resp_command(&c->out, 6, argv);
+    } else if (f->step == STEP_ACQUIRE) {
+        arg argv[] = {ARG("EXSET"), k, token, ARG("NX"), ARG("EX"), ttl, ARG("WITHVERSION")};
+        resp_command(&c->out, 7, argv);
+    } else if (f->step == STEP_RENEW && native) {
+        arg argv[] = {ARG("CAS"), k, token, token, ARG("EX"), ttl};
+        resp_command(&c->out, 6, argv);
+    } else if (f->step == STEP_RENEW) {
+        arg argv[] = {ARG("EXGAE"), k, ARG("EX"), ttl};
+        resp_command(&c->out, 4, argv);
+    } else if (native) {
+        arg argv[] = {ARG("CAD"), k, token};
+        resp_command(&c->out, 3, argv);
+    } else {
+        arg argv[] = {ARG("EXCAD"), k, {verbuf, (size_t)snprintf(verbuf, sizeof(verbuf), "%lld", f->version)}};
+        resp_command(&c->out, 3, argv);
+    }
+}
+
+/* Queue the request for the current step of 'f'. */
+static void send_step(worker *w, conn *c, inflight *f, const char *version, size_t version_len) {
+    char keybuf[64], incrmax[32];
+    arg k = key_arg(keybuf, sizeof(keybuf), f->op, f->key), v;
+    arg ver = {version, version_len};
+
+    v.p = next_value(&w->seed, &v.len);
+    f->req_start = bench_ns();
+    w->stats[f->op].requests++;
+
+    if (is_lock(f->op)) {
+        send_lock_step(c, f, k);
+        return;
+    }
+
+    if (f->step == STEP_READ) {
+        int native = f->op == OP_CAS || f->op == OP_CAD;
+        arg argv[] = {ARG(native ? "GET" : "EXGET"), k};
+        resp_command(&c->out, 2, argv);
+        return;
+    }
+    if (f->step == STEP_CREATE) {
+        int native = f->op == OP_CAS;
+        arg argv[] = {ARG(native ? "SET" : "EXSET"), k, v, ARG("NX")};
+        resp_command(&c->out, 4, argv);
+        return;
+    }
+
+    switch (f->op) {
+        case OP_EXSET: {
+            arg argv[] = {ARG("EXSET"), k, v};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+        case OP_EXSET_EX: {
+            arg argv[] = {ARG("EXSET"), k, v, ARG("EX"), ARG("3600"), ARG("WITHVERSION")};
+            resp_command(&c->out, 6, argv);
+            break;
+        }
+        case OP_EXSET_VER: {
+            arg argv[] = {ARG("EXSET"), k, v, ARG("VER"), ver};
+            resp_command(&c->out, 5, argv);
+            break;
+        }
+        case OP_EXGET: {
+            arg argv[] = {ARG("EXGET"), k};
+            resp_command(&c->out, 2, argv);
+            break;
+        }
+        case OP_EXINCRBY: {
+            snprintf(incrmax, sizeof(incrmax), "%lld", cfg.incr_max);
+            arg argv[] = {ARG("EXINCRBY"), k, ARG("1"), ARG("MIN"), ARG("0"), ARG("MAX"), ARG(incrmax)};
+            resp_command(&c->out, 7, argv);
+            break;
+        }
+        case OP_EXINCRBYFLOAT: {
+            arg argv[] = {ARG("EXINCRBYFLOAT"), k, ARG("0.25")};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+        case OP_EXCAS: {
+            arg argv[] = {ARG("EXCAS"), k, v, ver};
+            resp_command(&c->out, 4, argv);
+            break;
+        }
+        case OP_EXCAD: {
+            arg argv[] = {ARG("EXCAD"), k, ver};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+        case OP_EXGAE: {
+            arg argv[] = {ARG("EXGAE"), k, ARG("EX"), ARG("3600")};
+            resp_command(&c->out, 4, argv);
+            break;
+        }
+        case OP_EXAPPEND:
+        case OP_EXPREPEND: {
+            arg argv[] = {ARG(f->op == OP_EXAPPEND ? "EXAPPEND" : "EXPREPEND"), k, v};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+        case OP_SET: {
+            arg argv[] = {ARG("SET"), k, v};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+        case OP_GET: {
+            arg argv[] = {ARG("GET"), k};
+            resp_command(&c->out, 2, argv);
+            break;
+        }
+        case OP_CAS: {
+            arg argv[] = {ARG("CAS"), k, {f->old, f->old_len}, v};
+            resp_command(&c->out, 4, argv);
+            break;
+        }
+        case OP_CAD: {
+            arg argv[] = {ARG("CAD"), k, {f->old, f->old_len}};
+            resp_command(&c->out, 3, argv);
+            break;
+        }
+    }
+}
+
+static int multi_step(int op) {
+    return op == OP_EXSET_VER || op == OP_EXCAS || op == OP_EXCAD || op == OP_CAS || op == OP_CAD;
+}
+
+static int can_start(worker *w) {
+    if (w->quota) return w->started < w->quota;
+    return bench_ns() < w->deadline;
+}
+
+static void keep_old(inflight *f, const respValue *v) {
+    f->old = realloc(f->old, v->len ? v->len : 1);
+    memcpy(f->old, v->str, v->len);
+    f->old_len = v->len;
+}
+
+static void start_ops(worker *w, conn *c) {
+    while (c->count + c->nsleeping < cfg.pipeline && can_start(w)) {
+        inflight *f = &c->queue[(c->head + c->count) % cfg.pipeline];
+        c->count++;
+        w->started++;
+        f->op = pick_op(w);
+        f->step = is_lock(f->op) ? STEP_ACQUIRE : multi_step(f->op) ? STEP_READ : STEP_SINGLE;
+        f->attempts = 0;
+        f->renewals = 0;
+        if (is_lock(f->op)) {
+            char token[64];
+            respValue v = {.str = token};
+            v.len = snprintf(token, sizeof(token), "%llx-%llu", (unsigned long long)(uintptr_t)c,
+                             (unsigned long long)w->started);
+            keep_old(f, &v);
+        }
+        f->key = next_key(&w->seed);
+        f->op_start = bench_ns();
+        send_step(w, c, f, NULL, 0);
+    }
+}
+
+static void op_done(worker *w, inflight *f, uint64_t now) {
+    opStats *s = &w->stats[f->op];
+    s->ops++;
+    hist_add(&s->op_latency, now - f->op_start);
+}
+
+static int handle_lock_reply(worker *w, conn *c, inflight *f, const respReply *r, uint64_t now) {
+    opStats *s = &w->stats[f->op];
+    int held;
+
+    if (r->top.type == '-') {
+        if (s->errors++ < 3) fprintf(stderr, "loadgen: %s: %.*s\n", ops[f->op].name, (int)r->top.len, r->top.str);
+        op_done(w, f, now);
+        return OP_DONE;
+    }
+
+    switch (f->step) {
+        case STEP_ACQUIRE:
+            if (r->top.type == 0) {
+                /* Held by somebody else, try again after the backoff. */
+                s->retries++;
+                f->wake_at = now + (uint64_t)(cfg.lock_backoff_ms * 1e6);
+                return OP_SLEEP;
+            }
+            f->version = r->top.type == ':' ? r->top.integer : 0;
+            hist_add(&s->acquire_latency, now - f->op_start);
+            c->acquired++;
+            f->step = cfg.lock_renewals ? STEP_RENEW : STEP_RELEASE;
+            break;
+        case STEP_RENEW:
+            /* CAS replies 1, EXGAE replies [value, version, flags] and the
+             * value must still be our token. */
+            if (f->op == OP_LOCK) {
+                held = r->top.type == ':' && r->top.integer == 1;
+            } else {
+                held = r->top.type == '*' && r->elements >= 1 && r->element[0].len == f->old_len &&
+                       !memcmp(r->element[0].str, f->old, f->old_len);
+            }
+            if (!held) {
+                s->conflicts++;
+                op_done(w, f, now);
+                return OP_DONE;
+            }
+            if (++f->renewals >= cfg.lock_renewals) f->step = STEP_RELEASE;
+            break;
+        default:
+            if (!(r->top.type == ':' && r->top.integer == 1)) s->conflicts++;
+            op_done(w, f, now);
+            return OP_DONE;
+    }
+
+    /* Hold the lock before the next step. */
+    if (cfg.lock_hold_ms > 0) {
+        f->wake_at = now + (uint64_t)(cfg.lock_hold_ms * 1e6);
+        return OP_SLEEP;
+    }
+    send_step(w, c, f, NULL, 0);
+    return OP_NEXT;
+}
+
+/* Handle the reply to the oldest in-flight request of 'c'. Returns OP_NEXT
+ * if the operation needs another round trip, which is then already queued,
+ * and OP_SLEEP if it must wait before the next one. */
+static int handle_reply(worker *w, conn *c, inflight *f, const respReply *r) {
+    opStats *s = &w->stats[f->op];
+    uint64_t now = bench_ns();
+    char verbuf[32];
+
+    hist_add(&s->req_latency, now - f->req_start);
+    if (is_lock(f->op)) return handle_lock_reply(w, c, f, r, now);
+
+    if (r->top.type == '-') {
+        if (f->op == OP_EXSET_VER && f->step == STEP_WRITE && r->top.len >= 10 &&
+            memmem(r->top.str, r->top.len, "stale", 5) && ++f->attempts <= cfg.max_retries) {
+            /* Somebody wrote in between, read again. */
+            s->retries++;
+            f->step = STEP_READ;
+            send_step(w, c, f, NULL, 0);
+            return OP_NEXT;
+        }
+        if ((f->op == OP_EXINCRBY || f->op == OP_EXINCRBYFLOAT) && memmem(r->top.str, r->top.len, "overflow", 8)) {
+            s->rejected++;
+        } else if (f->op == OP_EXSET_VER && memmem(r->top.str, r->top.len, "stale", 5)) {
+            s->conflicts++;
+        } else {
+            if (s->errors++ < 3) fprintf(stderr, "loadgen: %s: %.*s\n", ops[f->op].name, (int)r->top.len, r->top.str);
+        }
+        op_done(w, f, now);
+        return OP_DONE;
+    }
+
+    switch (f->step) {
+        case STEP_SINGLE:
+            if (r->top.type == 0) s->misses++;
+            break;
+        case STEP_CREATE:
+            /* A concurrent creation makes NX fail, that is a conflict. */
+            if (r->top.type == 0) s->conflicts++;
+            break;
+        case STEP_READ:
+            if (r->top.type == 0) {
+                if (f->op == OP_EXCAD || f->op == OP_CAD) {
+                    s->misses++;
+                    break;
+                }
+                f->step = STEP_CREATE;
+                send_step(w, c, f, NULL, 0);
+                return OP_NEXT;
+            }
+            f->step = STEP_WRITE;
+            if (f->op == OP_CAS || f->op == OP_CAD) {
+                keep_old(f, &r->top);
+                send_step(w, c, f, NULL, 0);
+            } else {
+                /* EXGET: [value, version] */
+                long long ver = r->elements >= 2 ? r->element[1].integer : 0;
+                send_step(w, c, f, verbuf, snprintf(verbuf, sizeof(verbuf), "%lld", ver));
+            }
+            return OP_NEXT;
+        case STEP_WRITE:
+            if (f->op == OP_EXCAS && r->top.type == '*' && r->elements == 3 && r->element[0].type == '+' &&
+                r->element[0].len != 2) {
+                /* CAS_FAILED, value, version: retry right away with the
+                 * version the reply carries. */
+                if (++f->attempts > cfg.max_retries) {
+                    s->conflicts++;
+                    break;
+                }
+                s->retries++;
+                send_step(w, c, f, verbuf, snprintf(verbuf, sizeof(verbuf), "%lld", r->element[2].integer));
+                return OP_NEXT;
+            }
+            if (r->top.type == ':' && r->top.integer == -1) {
+                /* EXCAS/EXCAD/CAS/CAD: deleted since we read it. */
+                s->misses++;
+                break;
+            }
+            if (r->top.type == ':' && r->top.integer == 0) {
+                if (f->op == OP_CAS && ++f->attempts <= cfg.max_retries) {
+                    s->retries++;
+                    f->step = STEP_READ;
+                    send_step(w, c, f, NULL, 0);
+                    return OP_NEXT;
+                }
+                s->conflicts++;
+            }
+            break;
+    }
+    op_done(w, f, now);
+    return OP_DONE;
+}
+
+/* Parse every complete reply in the read buffer. */
+static void process_replies(worker *w, conn *c) {
+    respReply r;
+    long l;
+    while (c->count && (l = resp_parse(c->in.buf + c->in.pos, c->in.len - c->in.pos, &r)) > 0) {
+        inflight *f = &c->queue[c->head];
+        /* A follow-up request keeps the pipeline slot, but moves to the tail
+         * since its reply comes after those already in flight. */
+        int next = handle_reply(w, c, f, &r);
+        c->in.pos += l;
+        if (next == OP_NEXT) {
+            int tail = (c->head + c->count) % cfg.pipeline;
+            if (tail != c->head) {
+                free(c->queue[tail].old);
+                c->queue[tail] = *f;
+                f->old = NULL;
+            }
+            c->head = (c->head + 1) % cfg.pipeline;
+        } else if (next == OP_SLEEP) {
+            c->sleeping[c->nsleeping++] = *f;
+            f->old = NULL;
+            c->head = (c->head + 1) % cfg.pipeline;
+            c->count--;
+        } else {
+            c->head = (c->head + 1) % cfg.pipeline;
+            c->count--;
+        }
+    }
+    if (c->count && l < 0) {
+        fprintf(stderr, "loadgen: protocol error\n");
+        exit(1);
+    }
+    buf_compact(&c->in);
+}
+
+/* Requeue the sleeping operations that are due. Returns the time the next
+ * one is, UINT64_MAX if none. */
+static uint64_t wake_sleepers(worker *w, conn *c, uint64_t now) {
+    uint64_t next = UINT64_MAX;
+    for (int j = 0; j < c->nsleeping;) {
+        inflight *z = &c->sleeping[j];
+        if (z->wake_at > now) {
+            if (z->wake_at < next) next = z->wake_at;
+            j++;
+            continue;
+        }
+        inflight *f = &c->queue[(c->head + c->count) % cfg.pipeline];
+        free(f->old);
+        *f = *z;
+        c->count++;
+        *z = c->sleeping[--c->nsleeping];
+        c->sleeping[c->nsleeping].old = NULL;
+        send_step(w, c, f, NULL, 0);
+    }
+    return next;
+}
+
+static void *worker_main(void *arg) {
+    worker *w = arg;
+    struct pollfd *pfd = calloc(w->nconns, sizeof(*pfd));
+    int active;
+
+    for (int j = 0; j < w->nconns; j++) start_ops(w, &w->conns[j]);
+
+    do {
+        uint64_t now = bench_ns(), next_wake = UINT64_MAX;
+        int timeout = 1000;
+        active = 0;
+        for (int j = 0; j < w->nconns; j++) {
+            conn *c = &w->conns[j];
+            uint64_t wake = c->nsleeping ? wake_sleepers(w, c, now) : UINT64_MAX;
+            if (wake < next_wake) next_wake = wake;
+            pfd[j].fd = c->fd;
+            pfd[j].events = (c->count ? POLLIN : 0) | (c->out.pos < c->out.len ? POLLOUT : 0);
+            if (pfd[j].events || c->nsleeping) active++;
+        }
+        if (!active) break;
+        if (next_wake != UINT64_MAX) timeout = (int)((next_wake - now + 999999) / 1000000);
+        if (poll(pfd, w->nconns, timeout) < 0 && errno != EINTR) {
+            perror("loadgen: poll");
+            exit(1);
+        }
+        for (int j = 0; j < w->nconns; j++) {
+            conn *c = &w->conns[j];
+            if (pfd[j].revents & (POLLERR | POLLHUP)) {
+                fprintf(stderr, "loadgen: connection lost\n");
+                exit(1);
+            }
+            if (pfd[j].revents & POLLOUT) {
+                ssize_t n = write(c->fd, c->out.buf + c->out.pos, c->out.len - c->out.pos);
+                if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    perror("loadgen: write");
+                    exit(1);
+                }
+                if (n > 0) {
+                    c->out.pos += n;
+                    w->bytes_sent += n;
+                }
+                if (c->out.pos == c->out.len) c->out.len = c->out.pos = 0;
+            }
+            if (pfd[j].revents & POLLIN) {
+                buf_reserve(&c->in, 16384);
+                ssize_t n = read(c->fd, c->in.buf + c->in.len, c->in.cap - c->in.len);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                    fprintf(stderr, "loadgen: connection lost\n");
+                    exit(1);
+                }
+                if (n > 0) {
+                    c->in.len += n;
+                    process_replies(w, c);
+                    start_ops(w, c);
+                }
+            }
+        }
+    } while (1);
+
+    free(pfd);
+    return NULL;
+}
+
+/* ========================== Setup ========================== */
+
+/* Write every key the mix touches, so that reads hit and CAS has something
+ * to compare with. */
+static void populate(void) {
+    int fd = connect_server(), prefixes = 0;
+    buffer out = {0}, in = {0};
+    uint64_t seed = cfg.seed ^ 0x5bd1e995;
+    const char *done[OP_COUNT];
+
+    if (cfg.auth) {
+        arg argv[] = {ARG("AUTH"), ARG(cfg.auth)};
+        resp_command(&out, 2, argv);
+        sync_exchange(fd, &out, &in, 1);
+    }
+    for (int op = 0; op < OP_COUNT; op++) {
+        int seen = 0;
+        if (!cfg.weight[op] || is_lock(op)) continue; /* Locks start free. */
+        for (int j = 0; j < prefixes; j++) seen |= !strcmp(done[j], ops[op].prefix);
+        if (seen) continue;
+        done[prefixes++] = ops[op].prefix;
+
+        uint64_t batch = 0;
+        for (uint64_t key = 0; key < cfg.keyspace; key++) {
+            char keybuf[64];
+            arg k = key_arg(keybuf, sizeof(keybuf), op, key), v;
+            if (op == OP_EXINCRBY || op == OP_EXINCRBYFLOAT) {
+                v = ARG("0");
+            } else {
+                v.p = next_value(&seed, &v.len);
+            }
+            arg argv[] = {ARG(ops[op].prefix[0] == 's' ? "SET" : "EXSET"), k, v};
+            resp_command(&out, 3, argv);
+            if (++batch == 1000 || out.len >= (1 << 22)) {
+                sync_exchange(fd, &out, &in, batch);
+                batch = 0;
+            }
+        }
+        if (batch) sync_exchange(fd, &out, &in, batch);
+    }
+    free(out.buf);
+    free(in.buf);
+    close(fd);
+}
+
+static void usage(int status) {
+    fprintf(status ? stderr : stdout,
+            "Usage: loadgen [options]\n"
+            "  -h <host>            server host (127.0.0.1)\n"
+            "  -p <port>            server port (6379)\n"
+            "  -a <password>        AUTH password\n"
+            "  -c <connections>     total connections (50)\n"
+            "  -t <threads>         threads sharing the connections (1)\n"
+            "  -P <pipeline>        operations in flight per connection (1)\n"
+            "  -n <operations>      operations to run (100000)\n"
+            "  -d <seconds>         run for a duration instead of -n\n"
+            "  -r <keyspace>        number of distinct keys per prefix (100000)\n"
+            "  -m <mix>             operation mix, name:weight,... (exset:50,exget:50)\n"
+            "  -s <sizes>           value sizes: N, MIN-MAX or N:weight,... (64)\n"
+            "  --zipf <s>           zipf key skew, e.g. 0.99; 0 is uniform (0)\n"
+            "  --max-retries <n>    CAS retries before giving up (16)\n"
+            "  --incr-max <n>       MAX of exincrby (1000000000)\n"
+            "  --lock-ttl <sec>     lock expire time (10)\n"
+            "  --lock-hold <ms>     time a lock is held, between renewals (1)\n"
+            "  --lock-renewals <n>  renewals while holding a lock (0)\n"
+            "  --lock-backoff <ms>  wait before retrying a held lock (1)\n"
+            "  --seed <n>           random seed\n"
+            "  --populate           write the whole keyspace first, with -n 0 only that\n"
+            "  --json               print the report as JSON\n"
+            "Operations:");
+    for (int j = 0; j < OP_COUNT; j++) fprintf(status ? stderr : stdout, " %s", ops[j].name);
+    fprintf(status ? stderr : stdout, "\n");
+    exit(status);
+}
+
+static void parse_mix(const char *spec) {
+    char *copy = strdup(spec), *save = NULL;
+    memset(cfg.weight, 0, sizeof(cfg.weight));
+    cfg.total_weight = 0;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *colon = strchr(tok, ':');
+        unsigned weight = 1;
+        int op;
+        if (colon) {
+            *colon = '\0';
+            weight = (unsigned)atoi(colon + 1);
+        }
+        for (op = 0; op < OP_COUNT; op++) {
+            if (!strcasecmp(tok, ops[op].name)) break;
+        }
+        if (op == OP_COUNT) {
+            fprintf(stderr, "loadgen: unknown operation '%s'\n", tok);
+            usage(1);
+        }
+        cfg.weight[op] += weight;
+        cfg.total_weight += weight;
+    }
+    free(copy);
+    if (!cfg.total_weight) usage(1);
+}
+
+static void parse_sizes(const char *spec) {
+    cfg.size_classes = 0;
+    cfg.size_total_weight = 0;
+    if (strchr(spec, ':')) {
+        char *copy = strdup(spec), *save = NULL;
+        for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+            if (cfg.size_classes == MAX_SIZE_CLASSES) usage(1);
+            cfg.size[cfg.size_classes] = strtoull(tok, NULL, 10);
+            cfg.size_weight[cfg.size_classes] = strchr(tok, ':') ? (unsigned)atoi(strchr(tok, ':') + 1) : 1;
+            cfg.size_total_weight += cfg.size_weight[cfg.size_classes];
+            if (cfg.size[cfg.size_classes] > cfg.size_max) cfg.size_max = cfg.size[cfg.size_classes];
+            cfg.size_classes++;
+        }
+        free(copy);
+        if (!cfg.size_total_weight) usage(1);
+    } else if (strchr(spec, '-')) {
+        cfg.size_min = strtoull(spec, NULL, 10);
+        cfg.size_max = strtoull(strchr(spec, '-') + 1, NULL, 10);
+        if (cfg.size_max < cfg.size_min) usage(1);
+    } else {
+        cfg.size_min = cfg.size_max = strtoull(spec, NULL, 10);
+    }
+}
+
+static void parse_options(int argc, char **argv) {
+    parse_mix("exset:50,exget:50");
+    for (int j = 1; j < argc; j++) {
+        const char *opt = argv[j];
+        int more = j + 1 < argc;
+        if (!strcmp(opt, "--help")) {
+            usage(0);
+        } else if (!strcmp(opt, "--populate")) {
+            cfg.populate = 1;
+        } else if (!strcmp(opt, "--json")) {
+            cfg.json = 1;
+        } else if (!more) {
+            usage(1);
+        } else if (!strcmp(opt, "-h")) {
+            cfg.host = argv[++j];
+        } else if (!strcmp(opt, "-p")) {
+            cfg.port = atoi(argv[++j]);
+        } else if (!strcmp(opt, "-a")) {
+            cfg.auth = argv[++j];
+        } else if (!strcmp(opt, "-c")) {
+            cfg.connections = atoi(argv[++j]);
+        } else if (!strcmp(opt, "-t")) {
+            cfg.threads = atoi(argv[++j]);
+        } else if (!strcmp(opt, "-P")) {
+            cfg.pipeline = atoi(argv[++j]);
+        } else if (!strcmp(opt, "-n")) {
+            cfg.requests = strtoull(argv[++j], NULL, 10);
+        } else if (!strcmp(opt, "-d")) {
+            cfg.duration = atof(argv[++j]);
+            cfg.requests = 0;
+        } else if (!strcmp(opt, "-r")) {
+            cfg.keyspace = strtoull(argv[++j], NULL, 10);
+        } else if (!strcmp(opt, "-m")) {
+            parse_mix(argv[++j]);
+        } else if (!strcmp(opt, "-s")) {
+            parse_sizes(argv[++j]);
+        } else if (!strcmp(opt, "--zipf")) {
+            cfg.zipf = atof(argv[++j]);
+        } else if (!strcmp(opt, "--max-retries")) {
+            cfg.max_retries = atoi(argv[++j]);
+        } else if (!strcmp(opt, "--lock-ttl")) {
+            cfg.lock_ttl = atoi(argv[++j]);
+        } else if (!strcmp(opt, "--lock-hold")) {
+            cfg.lock_hold_ms = atof(argv[++j]);
+        } else if (!strcmp(opt, "--lock-renewals")) {
+            cfg.lock_renewals = atoi(argv[++j]);
+        } else if (!strcmp(opt, "--lock-backoff")) {
+            cfg.lock_backoff_ms = atof(argv[++j]);
+        } else if (!strcmp(opt, "--incr-max")) {
+            cfg.incr_max = strtoll(argv[++j], NULL, 10);
+        } else if (!strcmp(opt, "--seed")) {
+            cfg.seed = strtoull(argv[++j], NULL, 10);
+        } else {
+            usage(1);
+        }
+    }
+    if (cfg.threads < 1 || cfg.connections < cfg.threads || cfg.pipeline < 1 || cfg.keyspace < 1 || cfg.zipf < 0 ||
+        cfg.lock_ttl < 1 || cfg.lock_renewals < 0 ||
+        (!cfg.requests && cfg.duration <= 0 && !cfg.populate)) {
+        usage(1);
+    }
+    if (!cfg.seed) cfg.seed = 1; /* xorshift never leaves zero. */
+}
+
+/* ========================== Report ========================== */
+
+static const double percentiles[] = {50, 90, 99, 99.9};
+
+/* Locks acquired per connection. */
+typedef struct lockSummary {
+    uint64_t min, max;
+    double fairness; /* Jain's index: 1 when every connection got the same share. */
+} lockSummary;
+
+static void report(opStats *total, const lockSummary *locks, uint64_t bytes_sent, double elapsed) {
+    int with_locks = cfg.weight[OP_EXLOCK] || cfg.weight[OP_LOCK];
+
+    opStats all = {0};
+    uint64_t ops_total = 0;
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        ops_total += total[op].ops;
+        all.requests += total[op].requests;
+        hist_merge(&all.req_latency, &total[op].req_latency);
+    }
+
+    if (cfg.json) {
+        printf("{\n  \"suite\": \"loadgen\",\n  \"timestamp\": %ld,\n", (long)time(NULL));
+        printf("  \"config\": {\"connections\": %d, \"threads\": %d, \"pipeline\": %d, \"keyspace\": %llu, "
+               "\"zipf\": %g, \"value_size_min\": %zu, \"value_size_max\": %zu},\n",
+               cfg.connections, cfg.threads, cfg.pipeline, (unsigned long long)cfg.keyspace, cfg.zipf,
+               cfg.size_classes ? cfg.size[0] : cfg.size_min, cfg.size_max);
+        printf("  \"elapsed_sec\": %.3f,\n  \"ops\": %llu,\n  \"ops_per_sec\": %.0f,\n  \"requests_per_sec\": %.0f,\n"
+               "  \"bytes_sent\": %llu,\n",
+               elapsed, (unsigned long long)ops_total, (double)ops_total / elapsed, (double)all.requests / elapsed,
+               (unsigned long long)bytes_sent);
+        if (with_locks) {
+            printf("  \"lock_fairness\": %.4f,\n  \"lock_acquired_min\": %llu,\n  \"lock_acquired_max\": %llu,\n",
+                   locks->fairness, (unsigned long long)locks->min, (unsigned long long)locks->max);
+        }
+        printf("  \"results\": [");
+        int first = 1;
+        for (int op = 0; op < OP_COUNT; op++) {
+            opStats *s = &total[op];
+            if (!cfg.weight[op]) continue;
+            printf("%s\n    {\"op\": \"%s\", \"ops\": %llu, \"ops_per_sec\": %.0f, \"requests\": %llu, "
+                   "\"retries\": %llu, \"conflicts\": %llu, \"misses\": %llu, \"rejected\": %llu, \"errors\": %llu",
+                   first ? "" : ",", ops[op].name, (unsigned long long)s->ops, (double)s->ops / elapsed,
+                   (unsigned long long)s->requests, (unsigned long long)s->retries,
+                   (unsigned long long)s->conflicts, (unsigned long long)s->misses,
+                   (unsigned long long)s->rejected, (unsigned long long)s->errors);
+            for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+                printf(", \"p%g_us\": %.1f", percentiles[p], hist_percentile_us(&s->op_latency, percentiles[p]));
+            }
+            printf(", \"max_us\": %.1f, \"request_p99_us\": %.1f", (double)s->op_latency.max / 1000,
+                   hist_percentile_us(&s->req_latency, 99));
+            if (is_lock(op)) {
+                printf(", \"acquire_p50_us\": %.1f, \"acquire_p99_us\": %.1f, \"acquire_p99.9_us\": %.1f",
+                       hist_percentile_us(&s->acquire_latency, 50), hist_percentile_us(&s->acquire_latency, 99),
+                       hist_percentile_us(&s->acquire_latency, 99.9));
+            }
+            printf("}");
+            first = 0;
+        }
+        printf("\n  ]\n}\n");
+        return;
+    }
+
+    printf("%llu operations (%llu requests) in %.2f s, %d connections, %d threads, pipeline %d\n",
+           (unsigned long long)ops_total, (unsigned long long)all.requests, elapsed, cfg.connections, cfg.threads,
+           cfg.pipeline);
+    printf("throughput: %.0f ops/s, %.0f requests/s, %.1f bytes sent/op\n", (double)ops_total / elapsed,
+           (double)all.requests / elapsed, ops_total ? (double)bytes_sent / (double)ops_total : 0);
+    printf("request latency (us): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n\n",
+           hist_percentile_us(&all.req_latency, 50), hist_percentile_us(&all.req_latency, 99),
+           hist_percentile_us(&all.req_latency, 99.9), (double)all.req_latency.max / 1000);
+    printf("%-14s %10s %10s %7s %8s %9s %7s %7s %6s %9s %9s %9s %9s %9s\n", "op", "ops", "ops/s", "rt/op", "retries",
+           "conflicts", "misses", "reject", "errors", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    for (int op = 0; op < OP_COUNT; op++) {
+        opStats *s = &total[op];
+        if (!cfg.weight[op]) continue;
+        printf("%-14s %10llu %10.0f %7.2f %8llu %9llu %7llu %7llu %6llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               ops[op].name, (unsigned long long)s->ops, (double)s->ops / elapsed,
+               s->ops ? (double)s->requests / (double)s->ops : 0, (unsigned long long)s->retries,
+               (unsigned long long)s->conflicts, (unsigned long long)s->misses, (unsigned long long)s->rejected,
+               (unsigned long long)s->errors, hist_percentile_us(&s->op_latency, 50),
+               hist_percentile_us(&s->op_latency, 90), hist_percentile_us(&s->op_latency, 99),
+               hist_percentile_us(&s->op_latency, 99.9), (double)s->op_latency.max / 1000);
+    }
+    if (!with_locks) return;
+
+    printf("\n%-14s %10s %12s %9s %9s %9s %9s\n", "lock", "acquired", "wasted rt/acq", "lost", "p50 us", "p99 us",
+           "p99.9 us");
+    for (int op = 0; op < OP_COUNT; op++) {
+        opStats *s = &total[op];
+        if (!cfg.weight[op] || !is_lock(op)) continue;
+        printf("%-14s %10llu %12.2f %9llu %9.1f %9.1f %9.1f\n", ops[op].name,
+               (unsigned long long)s->acquire_latency.count,
+               s->acquire_latency.count ? (double)s->retries / (double)s->acquire_latency.count : 0,
+               (unsigned long long)s->conflicts, hist_percentile_us(&s->acquire_latency, 50),
+               hist_percentile_us(&s->acquire_latency, 99), hist_percentile_us(&s->acquire_latency, 99.9));
+    }
+    printf("acquisitions per connection: min %llu, max %llu, fairness (Jain) %.3f\n", (unsigned long long)locks->min,
+           (unsigned long long)locks->max, locks->fairness);
+}
+
+int main(int argc, char **argv) {
+    worker *workers;
+    opStats *total;
+    uint64_t seed;
+
+    parse_options(argc, argv);
+    if (cfg.zipf > 0) zipf_init(&zipf, cfg.keyspace, cfg.zipf);
+
+    seed = cfg.seed;
+    value_pool_len = cfg.size_max + 4096;
+    value_pool = malloc(value_pool_len);
+    for (size_t j = 0; j < value_pool_len; j++) value_pool[j] = 'a' + bench_rand(&seed) % 26;
+
+    if (cfg.populate) populate();
+    if (!cfg.requests && cfg.duration <= 0) return 0; /* -n 0 --populate: only load the dataset. */
+
+    workers = calloc(cfg.threads, sizeof(*workers));
+    total = calloc(OP_COUNT, sizeof(*total));
+    for (int t = 0; t < cfg.threads; t++) {
+        worker *w = &workers[t];
+        w->nconns = cfg.connections / cfg.threads + (t < cfg.connections % cfg.threads);
+        w->conns = calloc(w->nconns, sizeof(conn));
+        w->seed = cfg.seed + 0x9e3779b97f4a7c15ULL * (t + 1);
+        w->quota = cfg.requests ? cfg.requests / cfg.threads + (t < (int)(cfg.requests % cfg.threads)) : 0;
+        for (int j = 0; j < w->nconns; j++) {
+            conn *c = &w->conns[j];
+            c->fd = connect_server();
+            c->queue = calloc(cfg.pipeline, sizeof(inflight));
+            c->sleeping = calloc(cfg.pipeline, sizeof(inflight));
+            if (cfg.auth) {
+                arg a[] = {ARG("AUTH"), ARG(cfg.auth)};
+                resp_command(&c->out, 2, a);
+                sync_exchange(c->fd, &c->out, &c->in, 1);
+            }
+        }
+    }
+
+    uint64_t start = bench_ns();
+    for (int t = 0; t < cfg.threads; t++) {
+        workers[t].deadline = start + (uint64_t)(cfg.duration * 1e9);
+        pthread_create(&workers[t].tid, NULL, worker_main, &workers[t]);
+    }
+    for (int t = 0; t < cfg.threads; t++) pthread_join(workers[t].tid, NULL);
+    double elapsed = (double)(bench_ns() - start) / 1e9;
+    uint64_t bytes_sent = 0;
+    lockSummary locks = {UINT64_MAX, 0, 0};
+    double sum = 0, sumsq = 0;
+
+    for (int t = 0; t < cfg.threads; t++) {
+        bytes_sent += workers[t].bytes_sent;
+        for (int j = 0; j < workers[t].nconns; j++) {
+            uint64_t n = workers[t].conns[j].acquired;
+            if (n < locks.min) locks.min = n;
+            if (n > locks.max) locks.max = n;
+            sum += (double)n;
+            sumsq += (double)n * (double)n;
+        }
+        for (int op = 0; op < OP_COUNT; op++) {
+            opStats *d = &total[op], *s = &workers[t].stats[op];
+            d->ops += s->ops;
+            d->requests += s->requests;
+            d->retries += s->retries;
+            d->conflicts += s->conflicts;
+            d->misses += s->misses;
+            d->rejected += s->rejected;
+            d->errors += s->errors;
+            hist_merge(&d->op_latency, &s->op_latency);
+            hist_merge(&d->req_latency, &s->req_latency);
+            hist_merge(&d->acquire_latency, &s->acquire_latency);
+        }
+    }
+    locks.fairness = sumsq > 0 ? sum * sum / ((double)cfg.connections * sumsq) : 0;
+    report(total, &locks, bytes_sent, elapsed);
+    return 0;
+}
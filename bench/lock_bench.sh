@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+#
+# Lock contention: N clients competing for LOCKS locks.
+#
+# Two lock patterns are compared, both driven by loadgen:
+#   exlock  acquire with EXSET NX EX, renew with EXGAE, release with EXCAD;
+#   lock    acquire with SET NX EX, renew with CAS, release with CAD.
+# A client that finds the lock held retries after BACKOFF ms, and holds the
+# lock for HOLD ms (between RENEWALS renewals) once it has it. For every
+# client count in CLIENTS the report gives lock cycles per second, the
+# acquisition latency, the round trips wasted on held locks per acquisition,
+# the locks lost before release, and the fairness between clients.
+#
+# Requirements: cmake and redis-server / redis-cli in PATH (or REDIS_SERVER,
+# REDIS_CLI pointing to them). The module and loadgen are built into the work
+# directory unless MODULE and LOADGEN point to existing ones.
+#
+# Usage: bench/lock_bench.sh [workdir]
+# Tunables (environment): PORT, CLIENTS, LOCKS, DURATION (seconds per point),
+# HOLD, RENEWALS, BACKOFF, TTL, REPORT, MODULE, LOADGEN.
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=${1:-$ROOT/_bench/lock}
+# shellcheck source=bench/common.sh
+. "$ROOT/bench/common.sh"
+PORT=${PORT:-6399}
+CLIENTS=${CLIENTS:-"1 2 4 8 16 32 64 128"}
+LOCKS=${LOCKS:-1}
+DURATION=${DURATION:-10}
+HOLD=${HOLD:-1}
+RENEWALS=${RENEWALS:-1}
+BACKOFF=${BACKOFF:-1}
+TTL=${TTL:-10}
+REPORT=${REPORT:-$WORK/lock-report.md}
+PATTERNS=(exlock lock)
+
+require "$REDIS_SERVER" "$REDIS_CLI" cmake
+mkdir -p "$WORK"
+if [ -z "${MODULE:-}" ] || [ -z "${LOADGEN:-}" ]; then
+    echo "== building"
+    build "$WORK/build" -DTAIRSTRING_BUILD_BENCH=ON
+fi
+MODULE=${MODULE:-$WORK/build/lib/tairstring_module.so}
+LOADGEN=${LOADGEN:-$WORK/build/bench/loadgen}
+
+# Numeric field of a loadgen JSON line.
+field() { # <json> <name>
+    echo "$1" | sed -n "s/.*\"$2\": \([0-9.]*\).*/\1/p" | head -n 1
+}
+
+start_server "$PORT" "$MODULE"
+trap 'stop_server "$PORT"' EXIT
+
+{
+    echo "# Lock contention"
+    echo
+    echo "- date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "- commit: $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+    echo "- server: $("$REDIS_SERVER" --version)"
+    echo "- $LOCKS lock(s), hold ${HOLD} ms x $((RENEWALS + 1)), $RENEWALS renewal(s), backoff ${BACKOFF} ms," \
+        "${DURATION} s per point"
+    echo
+    echo "| pattern | clients | cycles/s | acquire p50 us | acquire p99 us | wasted rt/acquire | lost | fairness | min/max per client |"
+    echo "|---------|---------|----------|----------------|----------------|-------------------|------|----------|---------------------|"
+} >"$REPORT"
+
+for pattern in "${PATTERNS[@]}"; do
+    for clients in $CLIENTS; do
+        echo "== $pattern, $clients clients"
+        cli "$PORT" flushall >/dev/null
+        out=$("$LOADGEN" -p "$PORT" -c "$clients" -d "$DURATION" -r "$LOCKS" -m "$pattern" --lock-hold "$HOLD" \
+            --lock-renewals "$RENEWALS" --lock-backoff "$BACKOFF" --lock-ttl "$TTL" --json)
+        line=$(echo "$out" | grep "\"op\": \"$pattern\"")
+        ops=$(field "$line" ops)
+        retries=$(field "$line" retries)
+        awk -v p="$pattern" -v c="$clients" -v rate="$(field "$out" ops_per_sec)" \
+            -v p50="$(field "$line" acquire_p50_us)" -v p99="$(field "$line" acquire_p99_us)" \
+            -v wasted="$(awk -v r="$retries" -v o="$ops" 'BEGIN { printf "%.2f", (o > 0 ? r / o : 0) }')" \
+            -v lost="$(field "$line" conflicts)" -v fair="$(field "$out" lock_fairness)" \
+            -v min="$(field "$out" lock_acquired_min)" -v max="$(field "$out" lock_acquired_max)" \
+            'BEGIN { printf "| %s | %d | %d | %.1f | %.1f | %s | %d | %.3f | %d/%d |\n", p, c, rate, p50, p99, wasted, lost, fair, min, max }' \
+            >>"$REPORT"
+    done
+done
+
+cat "$REPORT"
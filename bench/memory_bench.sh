@@ -0,0 +1,98 @@
+#!/usr/bin/env bash
+#
+# Memory footprint of exstrtype keys against native strings, per value size.
+#
+# For every size in SIZES the same dataset is written as exstrtype keys and
+# as native strings, each into a freshly started server so that RSS is not
+# polluted by the previous run. The report gives, per key, the used_memory
+# and RSS growth, the overhead beyond the value bytes, and compares MEMORY
+# USAGE (TairStringTypeMemUsage for exstrtype) with the measured growth.
+#
+# The number of keys is KEYS, lowered for large values so that a dataset
+# stays under MAX_BYTES.
+#
+# Requirements: cmake and redis-server / redis-cli in PATH (or REDIS_SERVER,
+# REDIS_CLI pointing to them). The module and loadgen are built into the work
+# directory unless MODULE and LOADGEN point to existing ones.
+#
+# Usage: bench/memory_bench.sh [workdir]
+# Tunables (environment): PORT, KEYS, SIZES, MAX_BYTES, SAMPLES, TOLERANCE
+# (accepted MEMORY USAGE error, in percent), REPORT, MODULE, LOADGEN.
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=${1:-$ROOT/_bench/memory}
+# shellcheck source=bench/common.sh
+. "$ROOT/bench/common.sh"
+PORT=${PORT:-6399}
+KEYS=${KEYS:-200000}
+SIZES=${SIZES:-"1 16 64 256 1024 4096 16384 65536 262144 1048576"}
+MAX_BYTES=${MAX_BYTES:-2147483648}
+SAMPLES=${SAMPLES:-200}
+TOLERANCE=${TOLERANCE:-10}
+REPORT=${REPORT:-$WORK/memory-report.md}
+
+# kind|loadgen operation|key prefix used by loadgen
+KINDS=(
+    "exstrtype|exset|ex:"
+    "string|set|str:"
+)
+
+require "$REDIS_SERVER" "$REDIS_CLI" cmake
+mkdir -p "$WORK"
+if [ -z "${MODULE:-}" ] || [ -z "${LOADGEN:-}" ]; then
+    echo "== building"
+    build "$WORK/build" -DTAIRSTRING_BUILD_BENCH=ON
+fi
+MODULE=${MODULE:-$WORK/build/lib/tairstring_module.so}
+LOADGEN=${LOADGEN:-$WORK/build/bench/loadgen}
+
+# Average MEMORY USAGE over SAMPLES keys spread over the keyspace.
+memory_usage_avg() { # <prefix> <keys>
+    local prefix=$1 keys=$2 step i
+    step=$(((keys + SAMPLES - 1) / SAMPLES))
+    for ((i = 0; i < keys; i += step)); do
+        echo "MEMORY USAGE $prefix$i SAMPLES 0"
+    done | cli "$PORT" | awk '{ sum += $1; n++ } END { printf "%.1f", n ? sum / n : 0 }'
+}
+
+{
+    echo "# Memory footprint: exstrtype vs native strings"
+    echo
+    echo "- date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "- commit: $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+    echo "- server: $("$REDIS_SERVER" --version)"
+    echo "- MEMORY USAGE averaged over $SAMPLES keys, flagged when more than $TOLERANCE% off the measured growth"
+    echo
+    echo "| value bytes | kind | keys | used_memory/key | RSS/key | overhead/key | MEMORY USAGE/key | MEMORY USAGE error |"
+    echo "|-------------|------|------|-----------------|---------|--------------|------------------|--------------------|"
+} >"$REPORT"
+
+for size in $SIZES; do
+    keys=$((MAX_BYTES / size < KEYS ? MAX_BYTES / size : KEYS))
+    for entry in "${KINDS[@]}"; do
+        IFS='|' read -r kind op prefix <<<"$entry"
+        echo "== $size bytes, $kind: $keys keys"
+        start_server "$PORT" "$MODULE"
+        used0=$(info_field "$PORT" memory used_memory)
+        rss0=$(info_field "$PORT" memory used_memory_rss)
+        "$LOADGEN" -p "$PORT" -r "$keys" -m "$op" -s "$size" --populate -n 0
+        [ "$(cli "$PORT" dbsize)" = "$keys" ] || die "$kind: expected $keys keys"
+        used=$(info_field "$PORT" memory used_memory)
+        rss=$(info_field "$PORT" memory used_memory_rss)
+        usage=$(memory_usage_avg "$prefix" "$keys")
+        stop_server "$PORT"
+
+        awk -v size="$size" -v kind="$kind" -v keys="$keys" -v used="$((used - used0))" \
+            -v rss="$((rss - rss0))" -v usage="$usage" -v tol="$TOLERANCE" 'BEGIN {
+            per = used / keys
+            err = per > 0 ? (usage - per) / per * 100 : 0
+            flag = (err > tol || err < -tol) ? " **MISMATCH**" : ""
+            printf "| %d | %s | %d | %.1f | %.1f | %.1f | %.1f | %+.1f%%%s |\n",
+                size, kind, keys, per, rss / keys, per - size, usage, err, flag
+        }' >>"$REPORT"
+    done
+done
+
+cat "$REPORT"
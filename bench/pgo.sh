@@ -0,0 +1,119 @@
+#!/usr/bin/env bash
+#
+# Profile guided optimisation pipeline for tairstring_module.so.
+#
+#   1. build the reference module (Release, -O2) and an instrumented one;
+#   2. train: replay a representative EX* / CAS / CAD command mix against a
+#      local redis-server with the instrumented module loaded, then shut the
+#      server down cleanly so the profiles are flushed;
+#   3. rebuild the instrumented tree with the profiles (and LTO);
+#   4. measure every command of the mix on the reference and the PGO module
+#      and write a markdown report with the throughput gain per command.
+#
+# Requirements: GCC, cmake, and redis-server / redis-cli / redis-benchmark in
+# PATH (or REDIS_SERVER, REDIS_CLI, REDIS_BENCHMARK pointing to them).
+#
+# Usage: bench/pgo.sh [workdir]
+# Tunables (environment): PORT, TRAIN_REQUESTS, BENCH_REQUESTS, CLIENTS,
+# PIPELINE, KEYSPACE, ROUNDS, REPORT.
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=${1:-$ROOT/_pgo}
+# shellcheck source=bench/common.sh
+. "$ROOT/bench/common.sh"
+REDIS_BENCHMARK=${REDIS_BENCHMARK:-redis-benchmark}
+PORT=${PORT:-6399}
+TRAIN_REQUESTS=${TRAIN_REQUESTS:-200000}
+BENCH_REQUESTS=${BENCH_REQUESTS:-1000000}
+CLIENTS=${CLIENTS:-50}
+PIPELINE=${PIPELINE:-16}
+KEYSPACE=${KEYSPACE:-100000}
+ROUNDS=${ROUNDS:-3}
+REPORT=${REPORT:-$WORK/pgo-report.md}
+
+# name|command. __rand_int__ is expanded by redis-benchmark within KEYSPACE.
+WORKLOAD=(
+    "exset|EXSET ex:__rand_int__ value-of-a-typical-size-0123456789"
+    "exset_ver_ex|EXSET ex:__rand_int__ value-of-a-typical-size-0123456789 EX 3600 VER 0"
+    "exget|EXGET ex:__rand_int__"
+    "exget_withflags|EXGET ex:__rand_int__ WITHFLAGS"
+    "exincrby|EXINCRBY cnt:__rand_int__ 1"
+    "exincrby_bounds|EXINCRBY cnt:__rand_int__ 3 MIN 0 MAX 1000000000 WITHVERSION"
+    "exincrbyfloat|EXINCRBYFLOAT flt:__rand_int__ 0.25"
+    "excas|EXCAS ex:__rand_int__ newvalue 2"
+    "excad|EXCAD ex:__rand_int__ 1000000"
+    "exgae|EXGAE ex:__rand_int__ EX 3600"
+    "exappend|EXAPPEND app:__rand_int__ x"
+    "set|SET str:__rand_int__ old"
+    "cas|CAS str:__rand_int__ old old"
+    "cad|CAD str:__rand_int__ nomatch"
+)
+
+require "$REDIS_SERVER" "$REDIS_CLI" "$REDIS_BENCHMARK" cmake
+
+run_workload() { # <requests> <csv out or ->
+    local requests=$1 out=$2 entry name cmd rps
+    for entry in "${WORKLOAD[@]}"; do
+        name=${entry%%|*}
+        cmd=${entry#*|}
+        # shellcheck disable=SC2086
+        rps=$("$REDIS_BENCHMARK" -p "$PORT" -q --csv -n "$requests" -c "$CLIENTS" -P "$PIPELINE" \
+            -r "$KEYSPACE" $cmd | tail -n 1 | cut -d, -f2 | tr -d '"')
+        [ "$out" = "-" ] || echo "$name,$rps" >>"$out"
+    done
+}
+
+measure() { # <module> <csv out>
+    local i
+    start_server "$PORT" "$1"
+    : >"$2"
+    for i in $(seq 1 "$ROUNDS"); do
+        cli "$PORT" flushall >/dev/null
+        run_workload "$BENCH_REQUESTS" "$2"
+    done
+    stop_server "$PORT"
+}
+
+mkdir -p "$WORK"
+
+echo "== building reference module (Release -O2)"
+build "$WORK/build-o2" -DTAIRSTRING_BUILD_BENCH=OFF
+echo "== building instrumented module"
+rm -rf "$WORK/build-pgo" "$WORK/profiles"
+build "$WORK/build-pgo" -DTAIRSTRING_BUILD_BENCH=OFF -DTAIRSTRING_PGO=GEN -DTAIRSTRING_PGO_DIR="$WORK/profiles"
+
+echo "== training"
+start_server "$PORT" "$WORK/build-pgo/lib/tairstring_module.so"
+run_workload "$TRAIN_REQUESTS" -
+# A clean exit is what makes the instrumented module write its profiles.
+stop_server "$PORT"
+ls "$WORK/profiles"/*.gcda >/dev/null 2>&1 || die "no profiles were written to $WORK/profiles"
+
+echo "== rebuilding with profiles and LTO"
+build "$WORK/build-pgo" -DTAIRSTRING_BUILD_BENCH=OFF -DTAIRSTRING_PGO=USE -DTAIRSTRING_LTO=ON
+
+echo "== measuring"
+measure "$WORK/build-o2/lib/tairstring_module.so" "$WORK/o2.csv"
+measure "$WORK/build-pgo/lib/tairstring_module.so" "$WORK/pgo.csv"
+
+# Best of ROUNDS for each command, to filter out noisy runs.
+best() { sort -t, -k1,1 -k2,2gr "$1" | awk -F, '!seen[$1]++'; }
+
+{
+    echo "# tairstring_module PGO report"
+    echo
+    echo "- date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "- commit: $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+    echo "- compiler: $(cc --version | head -n 1)"
+    echo "- server: $("$REDIS_SERVER" --version)"
+    echo "- load: $BENCH_REQUESTS requests x $ROUNDS rounds, $CLIENTS clients, pipeline $PIPELINE, keyspace $KEYSPACE"
+    echo
+    echo "| command | -O2 (ops/s) | PGO+LTO (ops/s) | gain |"
+    echo "|---------|-------------|-----------------|------|"
+    join -t, <(best "$WORK/o2.csv" | sort) <(best "$WORK/pgo.csv" | sort) |
+        awk -F, '{ printf "| %s | %.0f | %.0f | %+.1f%% |\n", $1, $2, $3, ($3 / $2 - 1) * 100 }'
+} >"$REPORT"
+
+cat "$REPORT"
@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+#
+# RDB save/load throughput of exstrtype keys against native strings.
+#
+# The same dataset (KEYS keys, value sizes drawn from SIZES) is written once
+# as exstrtype keys with EXSET and once as native strings with SET. Each is
+# then timed ROUNDS times for SAVE, DEBUG RELOAD (save + load) and a restart
+# of the server on the RDB file (load only), and the report gives keys/s for
+# each, the RDB bytes per key, and the exstrtype/string ratios.
+#
+# Requirements: cmake and redis-server / redis-cli in PATH (or REDIS_SERVER,
+# REDIS_CLI pointing to them). The module and loadgen are built into the work
+# directory unless MODULE and LOADGEN point to existing ones.
+#
+# Usage: bench/rdb_bench.sh [workdir]
+# Tunables (environment): PORT, KEYS, SIZES (loadgen -s syntax, e.g. 64,
+# 16-1024 or 64:90,4096:10), ROUNDS, REPORT, MODULE, LOADGEN.
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=${1:-$ROOT/_bench/rdb}
+# shellcheck source=bench/common.sh
+. "$ROOT/bench/common.sh"
+PORT=${PORT:-6399}
+KEYS=${KEYS:-1000000}
+SIZES=${SIZES:-64}
+ROUNDS=${ROUNDS:-3}
+REPORT=${REPORT:-$WORK/rdb-report.md}
+
+# kind|loadgen operation used to write the dataset
+KINDS=(
+    "exstrtype|exset"
+    "string|set"
+)
+
+require "$REDIS_SERVER" "$REDIS_CLI" cmake
+mkdir -p "$WORK"
+if [ -z "${MODULE:-}" ] || [ -z "${LOADGEN:-}" ]; then
+    echo "== building"
+    build "$WORK/build" -DTAIRSTRING_BUILD_BENCH=ON
+fi
+MODULE=${MODULE:-$WORK/build/lib/tairstring_module.so}
+LOADGEN=${LOADGEN:-$WORK/build/bench/loadgen}
+
+ms_since() { echo $((($(now_ns) - $1) / 1000000)); }
+
+# Best (lowest) time of a kind/phase in the results.
+best() { awk -F, -v k="$1" -v p="$2" '$1 == k && $2 == p && (min == "" || $3 < min) { min = $3 } END { print min }' "$WORK/rdb.csv"; }
+
+: >"$WORK/rdb.csv"
+declare -A NKEYS RDB_BYTES
+for entry in "${KINDS[@]}"; do
+    kind=${entry%%|*}
+    op=${entry#*|}
+    rdb="$kind.rdb"
+    # shellcheck disable=SC2046
+    set -- --dbfilename "$rdb" $(debug_args)
+
+    echo "== $kind: writing $KEYS keys"
+    start_server "$PORT" "$MODULE" "$@"
+    cli "$PORT" flushall >/dev/null
+    "$LOADGEN" -p "$PORT" -r "$KEYS" -m "$op" -s "$SIZES" --populate -n 0
+    NKEYS[$kind]=$(cli "$PORT" dbsize)
+
+    for i in $(seq 1 "$ROUNDS"); do
+        echo "== $kind: round $i"
+        t=$(now_ns)
+        cli "$PORT" save >/dev/null
+        echo "$kind,save,$(ms_since "$t")" >>"$WORK/rdb.csv"
+        t=$(now_ns)
+        cli "$PORT" debug reload >/dev/null
+        echo "$kind,reload,$(ms_since "$t")" >>"$WORK/rdb.csv"
+    done
+    [ "$(cli "$PORT" dbsize)" = "${NKEYS[$kind]}" ] || die "$kind: keys lost across DEBUG RELOAD"
+    RDB_BYTES[$kind]=$(stat -c %s "$WORK/$rdb")
+    stop_server "$PORT"
+
+    # A restart only loads, start_server returns once PING is answered.
+    for i in $(seq 1 "$ROUNDS"); do
+        t=$(now_ns)
+        start_server "$PORT" "$MODULE" "$@"
+        echo "$kind,load,$(ms_since "$t")" >>"$WORK/rdb.csv"
+        [ "$(cli "$PORT" dbsize)" = "${NKEYS[$kind]}" ] || die "$kind: keys lost across restart"
+        stop_server "$PORT"
+    done
+done
+
+rate() { awk -v k="$1" -v ms="$2" 'BEGIN { printf "%.0f", (ms > 0 ? k * 1000 / ms : 0) }'; }
+ratio() { awk -v a="$1" -v b="$2" 'BEGIN { printf "%.2f", (b > 0 ? a / b : 0) }'; }
+
+{
+    echo "# RDB save/load: exstrtype vs native strings"
+    echo
+    echo "- date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "- commit: $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+    echo "- server: $("$REDIS_SERVER" --version)"
+    echo "- dataset: $KEYS keys, value sizes $SIZES, best of $ROUNDS rounds"
+    echo
+    echo "| kind | keys | RDB bytes/key | SAVE keys/s | DEBUG RELOAD keys/s | restart load keys/s |"
+    echo "|------|------|---------------|-------------|---------------------|---------------------|"
+    for entry in "${KINDS[@]}"; do
+        kind=${entry%%|*}
+        n=${NKEYS[$kind]}
+        printf "| %s | %s | %s | %s | %s | %s |\n" "$kind" "$n" "$(ratio "${RDB_BYTES[$kind]}" "$n")" \
+            "$(rate "$n" "$(best "$kind" save)")" "$(rate "$n" "$(best "$kind" reload)")" \
+            "$(rate "$n" "$(best "$kind" load)")"
+    done
+    echo
+    echo "exstrtype / string: RDB size x$(ratio "${RDB_BYTES[exstrtype]}" "${RDB_BYTES[string]}")," \
+        "SAVE time x$(ratio "$(best exstrtype save)" "$(best string save)")," \
+        "load time x$(ratio "$(best exstrtype load)" "$(best string load)")."
+} >"$REPORT"
+
+cat "$REPORT"
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* This is the only translation unit of the bench binaries that includes
+ * redismodule.h, so the RedisModule_* pointers are defined exactly once. */
+
+#include "redismodule_shim.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "redismodule.h"
+#include "util.h"
+
+struct RedisModuleString {
+    size_t len;
+    char ptr[];
+};
+
+static void *shim_Alloc(size_t bytes) { return malloc(bytes); }
+static void *shim_Calloc(size_t nmemb, size_t size) { return calloc(nmemb, size); }
+static void *shim_Realloc(void *ptr, size_t bytes) { return realloc(ptr, bytes); }
+static void shim_Free(void *ptr) { free(ptr); }
+
+static const char *shim_StringPtrLen(const RedisModuleString *str, size_t *len) {
+    if (len) *len = str->len;
+    return str->ptr;
+}
+
+static int shim_StringToLongLong(const RedisModuleString *str, long long *ll) {
+    return m_string2ll(str->ptr, str->len, ll) ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+static RedisModuleString *shim_CreateString(RedisModuleCtx *ctx, const char *ptr, size_t len) {
+    REDISMODULE_NOT_USED(ctx);
+    return shimCreateString(ptr, len);
+}
+
+static RedisModuleString *shim_CreateStringFromLongLong(RedisModuleCtx *ctx, long long ll) {
+    char buf[32];
+    REDISMODULE_NOT_USED(ctx);
+    return shimCreateString(buf, m_ll2string(buf, sizeof(buf), ll));
+}
+
+static void shim_FreeString(RedisModuleCtx *ctx, RedisModuleString *str) {
+    REDISMODULE_NOT_USED(ctx);
+    shimFreeString(str);
+}
+
+static long long shim_Milliseconds(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void shimInit(void) {
+    RedisModule_Alloc = shim_Alloc;
+    RedisModule_Calloc = shim_Calloc;
+    RedisModule_Realloc = shim_Realloc;
+    RedisModule_Free = shim_Free;
+    RedisModule_StringPtrLen = shim_StringPtrLen;
+    RedisModule_StringToLongLong = shim_StringToLongLong;
+    RedisModule_CreateString = shim_CreateString;
+    RedisModule_CreateStringFromLongLong = shim_CreateStringFromLongLong;
+    RedisModule_FreeString = shim_FreeString;
+    RedisModule_Milliseconds = shim_Milliseconds;
+}
+
+RedisModuleString *shimCreateString(const char *ptr, size_t len) {
+    RedisModuleString *s = malloc(sizeof(*s) + len + 1);
+    s->len = len;
+    memcpy(s->ptr, ptr, len);
+    s->ptr[len] = '\0';
+    return s;
+}
+
+RedisModuleString *shimCreateCString(const char *s) { return shimCreateString(s, strlen(s)); }
+
+void shimFreeString(RedisModuleString *str) { free(str); }
+
+RedisModuleString **shimCreateArgv(int *argc, const char *first, ...) {
+    va_list ap;
+    const char *s;
+    int n = 0;
+
+    va_start(ap, first);
+    for (s = first; s; s = va_arg(ap, const char *)) n++;
+    va_end(ap);
+
+    RedisModuleString **argv = malloc(sizeof(*argv) * (n ? n : 1));
+    n = 0;
+    va_start(ap, first);
+    for (s = first; s; s = va_arg(ap, const char *)) argv[n++] = shimCreateCString(s);
+    va_end(ap);
+    *argc = n;
+    return argv;
+}
+
+RedisModuleString **shimSplitArgv(const char *line, int *argc) {
+    size_t cap = 8;
+    int n = 0;
+    RedisModuleString **argv = malloc(sizeof(*argv) * cap);
+
+    while (*line) {
+        while (*line == ' ' || *line == '\t' || *line == '\n' || *line == '\r') line++;
+        if (!*line) break;
+        const char *start = line;
+        while (*line && *line != ' ' && *line != '\t' && *line != '\n' && *line != '\r') line++;
+        if ((size_t)n == cap) {
+            cap *= 2;
+            argv = realloc(argv, sizeof(*argv) * cap);
+        }
+        argv[n++] = shimCreateString(start, line - start);
+    }
+    *argc = n;
+    return argv;
+}
+
+void shimFreeArgv(RedisModuleString **argv, int argc) {
+    for (int i = 0; i < argc; i++) shimFreeString(argv[i]);
+    free(argv);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* A minimal in-process stand-in for the RedisModule_* API, enough to drive
+ * tairstring_core without a server. It implements strings, integer parsing,
+ * allocation and the clock; every other API pointer stays NULL. */
+
+#pragma once
+
+#include <stddef.h>
+
+struct RedisModuleString;
+
+/* Point the RedisModule_* function pointers at the shim. */
+void shimInit(void);
+
+struct RedisModuleString *shimCreateString(const char *ptr, size_t len);
+struct RedisModuleString *shimCreateCString(const char *s);
+void shimFreeString(struct RedisModuleString *str);
+
+/* Build an argv array from a NULL terminated list of C strings, and free it. */
+struct RedisModuleString **shimCreateArgv(int *argc, const char *first, ...);
+struct RedisModuleString **shimSplitArgv(const char *line, int *argc);
+void shimFreeArgv(struct RedisModuleString **argv, int argc);
@@ -0,0 +1,118 @@
+#!/usr/bin/env bash
+#
+# Replication stream and AOF bytes per command.
+#
+# A primary with AOF enabled and a replica are started locally. For every
+# command shape below the keyspace is written first, then OPS operations are
+# run with loadgen, and the growth of master_repl_offset and of the AOF is
+# divided by the number of operations. The report also gives the bytes the
+# client sent per operation, and the ratio of replicated to sent bytes.
+#
+# Requirements: cmake and redis-server / redis-cli in PATH (or REDIS_SERVER,
+# REDIS_CLI pointing to them). The module and loadgen are built into the work
+# directory unless MODULE and LOADGEN point to existing ones.
+#
+# Usage: bench/repl_bench.sh [workdir]
+# Tunables (environment): PORT (the replica uses PORT + 1), OPS, KEYS, SIZES
+# (loadgen -s syntax), REPORT, MODULE, LOADGEN.
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=${1:-$ROOT/_bench/repl}
+# shellcheck source=bench/common.sh
+. "$ROOT/bench/common.sh"
+PORT=${PORT:-6399}
+REPLICA_PORT=$((PORT + 1))
+OPS=${OPS:-100000}
+KEYS=${KEYS:-10000}
+SIZES=${SIZES:-64}
+REPORT=${REPORT:-$WORK/repl-report.md}
+
+# Command shapes, as loadgen operations. Operations that fail (a stale
+# version, a CAS conflict) replicate nothing and lower the average.
+SHAPES=(
+    exset
+    exset_ex
+    exset_ver
+    exincrby
+    exincrbyfloat
+    excas
+    excad
+    exgae
+    exappend
+    exprepend
+    set
+    cas
+    cad
+)
+
+require "$REDIS_SERVER" "$REDIS_CLI" cmake
+mkdir -p "$WORK/primary" "$WORK/replica"
+if [ -z "${MODULE:-}" ] || [ -z "${LOADGEN:-}" ]; then
+    echo "== building"
+    build "$WORK/build" -DTAIRSTRING_BUILD_BENCH=ON
+fi
+MODULE=${MODULE:-$WORK/build/lib/tairstring_module.so}
+LOADGEN=${LOADGEN:-$WORK/build/bench/loadgen}
+
+cleanup() {
+    stop_server "$REPLICA_PORT"
+    stop_server "$PORT"
+}
+trap cleanup EXIT
+
+# Wait until the replica has processed the whole replication stream.
+wait_replica() {
+    local _ offset
+    for _ in $(seq 1 6000); do
+        offset=$(info_field "$PORT" replication master_repl_offset)
+        [ "$(info_field "$REPLICA_PORT" replication master_repl_offset)" = "$offset" ] && return 0
+        sleep 0.05
+    done
+    die "the replica does not catch up"
+}
+
+start_server "$PORT" "$MODULE" --dir "$WORK/primary" --appendonly yes --appendfsync no \
+    --auto-aof-rewrite-percentage 0
+start_server "$REPLICA_PORT" "$MODULE" --dir "$WORK/replica" --replicaof 127.0.0.1 "$PORT"
+for _ in $(seq 1 600); do
+    [ "$(info_field "$REPLICA_PORT" replication master_link_status)" = "up" ] && break
+    sleep 0.1
+done
+[ "$(info_field "$REPLICA_PORT" replication master_link_status)" = "up" ] || die "the replica does not sync"
+
+{
+    echo "# Replication and AOF bytes per command"
+    echo
+    echo "- date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "- commit: $(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+    echo "- server: $("$REDIS_SERVER" --version)"
+    echo "- load: $OPS operations over $KEYS keys, value sizes $SIZES"
+    echo
+    echo "| command | ops | client bytes/op | replication bytes/op | AOF bytes/op | replication / client |"
+    echo "|---------|-----|-----------------|----------------------|--------------|----------------------|"
+} >"$REPORT"
+
+for shape in "${SHAPES[@]}"; do
+    echo "== $shape"
+    cli "$PORT" flushall >/dev/null
+    "$LOADGEN" -p "$PORT" -r "$KEYS" -m "$shape" -s "$SIZES" --populate -n 0
+    wait_replica
+    repl0=$(info_field "$PORT" replication master_repl_offset)
+    aof0=$(info_field "$PORT" persistence aof_current_size)
+
+    out=$("$LOADGEN" -p "$PORT" -r "$KEYS" -m "$shape" -s "$SIZES" -n "$OPS" -c 8 --json)
+    ops=$(echo "$out" | sed -n 's/^ *"ops": \([0-9]*\),$/\1/p')
+    sent=$(echo "$out" | sed -n 's/^ *"bytes_sent": \([0-9]*\),$/\1/p')
+    wait_replica
+    repl1=$(info_field "$PORT" replication master_repl_offset)
+    aof1=$(info_field "$PORT" persistence aof_current_size)
+
+    awk -v shape="$shape" -v ops="$ops" -v sent="$sent" -v repl="$((repl1 - repl0))" -v aof="$((aof1 - aof0))" 'BEGIN {
+        printf "| %s | %d | %.1f | %.1f | %.1f | %.2f |\n", shape, ops, sent / ops, repl / ops, aof / ops,
+            (sent > 0 ? repl / sent : 0)
+    }' >>"$REPORT"
+done
+
+cat "$REPORT"
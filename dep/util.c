@@ -445,6 +445,62 @@ int m_d2string(char *buf, size_t len, double value) {
     return len;
 }
 
+#if defined(__SIZEOF_INT128__) && (LDBL_MANT_DIG <= 64)
+/* Exact replacement for snprintf("%.17Lf") followed by the trailing zeroes
+ * trimming done in m_ld2string(), for values whose integer part fits in 62
+ * bits. The fractional part of a long double is m * 2^-shift with m holding at
+ * most 64 bits, so m * 10^17 fits in 128 bits and the 17th decimal can be
+ * rounded exactly (half to even, as glibc does) with integer arithmetic only.
+ * Returns the string length, 0 if the buffer is too small, or -1 if the value
+ * is out of the supported range and the caller must fall back to snprintf(). */
+static int m_ld2string_fixed17(char *buf, size_t len, long double value) {
+    static const uint64_t pow10_17 = 100000000000000000ULL;
+    char tmp[64];
+    long double abs = fabsl(value), frac;
+    uint64_t ip, fp = 0;
+    int l = 0;
+
+    if (!(abs < 4611686018427387904.0L)) return -1; /* 2^62, also rejects NaN. */
+    ip = (uint64_t)abs;
+    frac = abs - (long double)ip; /* Exact. */
+    if (frac != 0) {
+        int e;
+        long double m = frexpl(frac, &e);
+        uint64_t mant = (uint64_t)ldexpl(m, LDBL_MANT_DIG);
+        int shift = LDBL_MANT_DIG - e; /* frac == mant * 2^-shift, shift >= 64 */
+        if (shift < 128) {
+            unsigned __int128 p = (unsigned __int128)mant * pow10_17;
+            unsigned __int128 half = (unsigned __int128)1 << (shift - 1);
+            unsigned __int128 rem = p & ((half << 1) - 1);
+            fp = (uint64_t)(p >> shift);
+            if (rem > half || (rem == half && (fp & 1))) fp++;
+            if (fp == pow10_17) {
+                fp = 0;
+                ip++;
+            }
+        }
+    }
+
+    if (signbit(value)) tmp[l++] = '-';
+    l += m_ll2string(tmp + l, sizeof(tmp) - l, (long long)ip);
+    if (fp != 0) {
+        int i;
+        tmp[l++] = '.';
+        for (i = 16; i >= 0; i--) {
+            tmp[l + i] = '0' + fp % 10;
+            fp /= 10;
+        }
+        l += 17;
+        while (tmp[l - 1] == '0') l--;
+    }
+
+    if ((size_t)l + 1 > len) return 0; /* No room. */
+    memcpy(buf, tmp, l);
+    buf[l] = '\0';
+    return l;
+}
+#endif
+
 /* Convert a long double into a string. If humanfriendly is non-zero
  * it does not use exponential format and trims trailing zeroes at the end,
  * however this results in loss of precision. Otherwise exp format is used
@@ -472,6 +528,10 @@ int m_ld2string(char *buf, size_t len, long double value, int humanfriendly) {
          * way that is "non surprising" for the user (that is, most small
          * decimal numbers will be represented in a way that when converted
          * back into a string are exactly the same as what the user typed.) */
+#if defined(__SIZEOF_INT128__) && (LDBL_MANT_DIG <= 64)
+        int fl = m_ld2string_fixed17(buf, len, value);
+        if (fl >= 0) return fl;
+#endif
         l = snprintf(buf, len, "%.17Lf", value);
         if (l + 1 > len) return 0; /* No room. */
         /* Now remove trailing zeroes after the '.' */
@@ -28,27 +28,15 @@
 #include <strings.h>
 
 #include "redismodule.h"
+#include "tairstring_core.h"
 #include "util.h"
-// 没有额外的参数。 不存在  存在   过期时间  
-// 版本。
-#define TAIR_STRING_SET_NO_FLAGS 0
-#define TAIR_STRING_SET_NX (1 << 0)
-#define TAIR_STRING_SET_XX (1 << 1)
-#define TAIR_STRING_SET_EX (1 << 2)
-#define TAIR_STRING_SET_PX (1 << 3)
-#define TAIR_STRING_SET_ABS_EXPIRE (1 << 4)
-#define TAIR_STRING_SET_WITH_VER (1 << 5)
-#define TAIR_STRING_SET_WITH_ABS_VER (1 << 6)
-#define TAIR_STRING_SET_WITH_BOUNDARY (1 << 7)
-#define TAIR_STRING_SET_WITH_FLAGS (1 << 8)
-#define TAIR_STRING_SET_WITH_DEF (1 << 9)
-#define TAIR_STRING_SET_NONEGATIVE (1 << 10)
-#define TAIR_STRING_RETURN_WITH_VER (1 << 11)
-#define TAIR_STRING_SET_KEEPTTL (1 << 12)
 
 #define TAIRSTRING_ENCVER_VER_1 0
+#define TAIRSTRING_UPLOAD_ENCVER_VER_1 0
 
 static RedisModuleType *TairStringType;
+/* An upload session of EXUPBEGIN, its value is the staged RedisModuleString. */
+static RedisModuleType *TairStringUploadType;
 // 代码中的#pragma pack(1)是一个编译指令，用来指定结构体成员变量的对齐方式为1字节，即按照最小对齐原则进行对齐。这样可以确保结构体在内存中的布局是紧凑的，节省内存空间。
 #pragma pack(1)
 typedef struct TairStringObj {
@@ -71,169 +59,51 @@ static void TairStringTypeReleaseObject(struct TairStringObj *o) {
 
     RedisModule_Free(o);
 }
-// 转成long double类型的。
-static int mstring2ld(RedisModuleString *val, long double *r_val) {
-    if (!val) return REDISMODULE_ERR;
-
-    size_t t_len;
-    const char *t_ptr = RedisModule_StringPtrLen(val, &t_len);
-    if (m_string2ld(t_ptr, t_len, r_val) == 0) {
-        return REDISMODULE_ERR;
-    }
-
-    return REDISMODULE_OK;
-}
-
-static int mstringcasecmp(const RedisModuleString *rs1, const char *s2) {
-    size_t n1 = strlen(s2);
-    size_t n2;
-    const char *s1 = RedisModule_StringPtrLen(rs1, &n2);
-    if (n1 != n2) {
-        return -1;
-    }
-    return strncasecmp(s1, s2, n1);
-}
-
-/* Parse the command **argv and get those arguments. Return ex_flags. If parsing
- * get failed, It would reply with syntax error. The first appearance would be
- * accepted if there are multiple appearance of a same group, For example: "EX
- * 3 PX 4000 EXAT 127", the "EX 3" would be accepted and the other two would be
- * ignored.
- * */
-/*
-1. 这个函数 parseAndGetExFlags 是一个静态函数，用于解析Redis命令参数并获取相关的标志（flags）。如果解析失败，它会返回语法错误。
-    argv：命令参数数组。
-    argc：参数数量。
-    start：解析开始的索引。
-    ex_flag：指向标志的指针，用于存储解析后的标志。
-    expire_p、version_p、flags_p、defaultvalue_p、min_p、max_p：指向不同参数的指针，用于存储相应的参数值。
-    allow_flags：允许的标志，用于验证解析后的标志是否合法。
-2. 这个函数的主要功能是解析传入的参数数组，并根据参数设置不同的标志。它确保标志的合法性，并处理冲突的标志。在解析过程中，如果发现任何语法错误或冲突，它会立即返回错误码 REDISMODULE_ERR。
-通过这种方式，函数能够有效地解析命令参数，并为后续的命令处理提供所需的标志和参数值。
-
-*/
-static int parseAndGetExFlags(RedisModuleString **argv, int argc, int start, int *ex_flag, RedisModuleString **expire_p,
-                              RedisModuleString **version_p, RedisModuleString **flags_p,
-                              RedisModuleString **defaultvalue_p, RedisModuleString **min_p,
-                              RedisModuleString **max_p, unsigned int allow_flags) {
-    // TAIR_STRING_SET_NO_FLAGS 初始值是0，然后如果存在某个标志位，将其和对应位置相与。
-    int j, ex_flags = TAIR_STRING_SET_NO_FLAGS;
-    for (j = start; j < argc; j++) {
-        RedisModuleString *next = (j == argc - 1) ? NULL : argv[j + 1];
-
-        if (!mstringcasecmp(argv[j], "nx")) {
-            // 如果没有设置 则才会进行设置？ 为什么要进行这个判断？ 
-            // 避免exset中重复的参数。【for循环，遍历 EXFalgs 的左右参数。EXFalgs 】
-            if (ex_flags & TAIR_STRING_SET_XX) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_NX;
-        } else if (!mstringcasecmp(argv[j], "xx")) {
-            if (ex_flags & TAIR_STRING_SET_NX) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_XX;
-        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "ex") && next) {
-            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_EX;
-            *expire_p = next;
-            j++;
-        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "exat") && next) {
-            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_EX;
-            ex_flags |= TAIR_STRING_SET_ABS_EXPIRE;
-            *expire_p = next;
-            j++;
-        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "px") && next) {
-            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_PX;
-            *expire_p = next;
-            j++;
-        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "pxat") && next) {
-            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_PX;
-            ex_flags |= TAIR_STRING_SET_ABS_EXPIRE;
-            // 时间
-            *expire_p = next;
-            j++;
-        } else if (version_p != NULL && !mstringcasecmp(argv[j], "ver") && next) {
-            if (ex_flags & (TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_VER;
-            // version 
-            *version_p = next;
-            j++;
-        } else if (version_p != NULL && !mstringcasecmp(argv[j], "abs") && next) {
-            if (ex_flags & (TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_ABS_VER;
-            *version_p = next;
-            j++;
-        } else if (flags_p != NULL && !mstringcasecmp(argv[j], "flags") && next) {
-            if (ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_FLAGS;
-            *flags_p = next;
-            j++;
-        } else if (defaultvalue_p != NULL && !mstringcasecmp(argv[j], "def") && next) { /* DEF disabled if XX set. */
-            if (ex_flags & TAIR_STRING_SET_WITH_DEF) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_DEF;
-            *defaultvalue_p = next;
-            j++;
-        } else if (min_p != NULL && !mstringcasecmp(argv[j], "min") && next) {
-            if (*min_p != NULL) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_BOUNDARY;
-            *min_p = next;
-            j++;
-        } else if (max_p != NULL && !mstringcasecmp(argv[j], "max") && next) {
-            if (*max_p != NULL) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_WITH_BOUNDARY;
-            *max_p = next;
-            j++;
-        } else if (!mstringcasecmp(argv[j], "nonegative")) {
-            ex_flags |= TAIR_STRING_SET_NONEGATIVE;
-        } else if (!mstringcasecmp(argv[j], "withversion")) {
-            ex_flags |= TAIR_STRING_RETURN_WITH_VER;
-        } else if (!mstringcasecmp(argv[j], "keepttl")) {
-            // 不能和 nx xx 一起使用。
-            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX)) {
-                return REDISMODULE_ERR;
-            }
-            ex_flags |= TAIR_STRING_SET_KEEPTTL;
-        } else {
-            return REDISMODULE_ERR;
+/* Store 'value' into a key opened for writing, once the preconditions of the
+ * write (NX/XX, VER, type) passed: create the object if the key is empty, set
+ * the next version, the flags and the expire, or keep the TTL with KEEPTTL.
+ * 'expire' is NULL without EX/EXAT/PX/PXAT, '*milliseconds' then receives the
+ * relative expire that was set. */
+static TairStringObj *tairStringStore(RedisModuleKey *key, RedisModuleString *value, int ex_flags, long long version,
+                                      long long flags, const long long *expire, long long *milliseconds) {
+    TairStringObj *o;
+
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+        o = createTairStringTypeObject();
+        RedisModule_ModuleTypeSetValue(key, TairStringType, o);
+    } else {
+        o = RedisModule_ModuleTypeGetValue(key);
+        /* Free the old value. */
+        if (o->value) {
+            RedisModule_FreeString(NULL, o->value);
         }
     }
-    
-if ((~allow_flags) & ex_flags) {
-        return REDISMODULE_ERR;
+    // 如果有绝对版本，则设置绝对版本，否则版本号+1
+    o->version = tairStringNextVersion(ex_flags, version, o->version);
+    o->value = value;
+    /* Reuse the value to avoid memory copies. */
+    RedisModule_RetainString(NULL, value);
+    if (ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
+        o->flags = flags;
     }
 
-    *ex_flag = ex_flags;
-    return REDISMODULE_OK;
+    if (expire) {
+        *milliseconds = tairStringRelativeExpire(ex_flags, *expire, RedisModule_Milliseconds());
+        RedisModule_SetExpire(key, *milliseconds);
+    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
+        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
+    }
+    return o;
 }
 
 /* ========================= "tairstring" type commands =======================*/
 // 官方文档里面，都没有  [FLAGS flags] [WITHVERSION]。
 // flags 应该就是 nonegative  withversion （exget 默认返回版本信息。）
-/* EXSET <key> <value> [EX/EXAT/PX/PXAT time] [NX/XX] [VER/ABS version] [FLAGS flags] [WITHVERSION] [KEEPTTL] */
+/* EXSET <key> <value> [EX/EXAT/PX/PXAT time] [NX/XX] [VER/ABS version] [FLAGS flags] [WITHVERSION] [KEEPTTL] [GET]
+ *
+ * With GET the reply is [[old value, old version] or nil, new version]. NX GET
+ * is a get-or-set: when the key exists nothing is written and the reply is
+ * [[value, version], nil]. */
 int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
     // 至少需要三个参数。
@@ -247,7 +117,8 @@ int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
     // 支持的参数。
     unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | 
                       TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER |
-                      TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_SET_WITH_FLAGS | TAIR_STRING_RETURN_WITH_VER;
+                      TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_SET_WITH_FLAGS | TAIR_STRING_RETURN_WITH_VER |
+                      TAIR_STRING_SET_GET;
     // 参数的起始位置是3 （不是从0开始的吗？ ）
     if (parseAndGetExFlags(argv, argc, 3, &ex_flags, &expire_p, &version_p, &flags_p, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
         // 参数解析失败。 ERR syntax error
@@ -288,9 +159,6 @@ int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
             RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
-        // 没有xx的限制，就可以创建一个新的key。
-        tair_string_obj = createTairStringTypeObject(); // 创建空白的 ts obj
-        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
     } else {
         // 如果key存在，并且不是ts类型，返回err
         if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
@@ -301,59 +169,36 @@ int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
         tair_string_obj = RedisModule_ModuleTypeGetValue(key);
         // 如果 nx 存在(也就是key不存在)才设置，表示不满足条件，返回err 【这个判断为什么不能前移？ 】
         if (ex_flags & TAIR_STRING_SET_NX) {
+            if (ex_flags & TAIR_STRING_SET_GET) {
+                RedisModule_ReplyWithArray(ctx, 2);
+                RedisModule_ReplyWithArray(ctx, 2);
+                RedisModule_ReplyWithString(ctx, tair_string_obj->value);
+                RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+                RedisModule_ReplyWithNull(ctx);
+                return REDISMODULE_OK;
+            }
             RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
 
         /* Version 0 means no version checking. */
         // 如果版本号不为0，并且版本号不匹配（更新操作的版本，与最新的不能对应上。 ），返回err
-        if (ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && version != tair_string_obj->version) {
+        if (!tairStringVersionMatches(ex_flags, version, tair_string_obj->version)) {
             RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
             return REDISMODULE_ERR;
         }
     }
-    // 如果有绝对版本，则设置绝对版本，否则版本号+1
-    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
-        tair_string_obj->version = version;
-    } else {
-        tair_string_obj->version++;
-    }
 
-    if (type != REDISMODULE_KEYTYPE_EMPTY) {
-        /* Free the old value. */
-        if (tair_string_obj->value) {
-            RedisModule_FreeString(ctx, tair_string_obj->value);
-        }
-    }
-    tair_string_obj->value = argv[2];
-    /* Reuse the value to avoid memory copies. */
-    RedisModule_RetainString(NULL, argv[2]);
-    // flags 好像都没有使用。
-    if (ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
-        tair_string_obj->flags = flags;
+    /* The store frees the old value, keep it for the GET reply. */
+    RedisModuleString *old_value = NULL;
+    uint64_t old_version = 0;
+    if ((ex_flags & TAIR_STRING_SET_GET) && tair_string_obj) {
+        old_value = tair_string_obj->value;
+        old_version = tair_string_obj->version;
+        RedisModule_RetainString(NULL, old_value);
     }
 
-    if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
-        }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            /* Since the RedisModule_SetExpire interface can only set relative
-            expiration times, here we first convert the absolute time passed
-            in by the user to relative time. */
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                /* Time out now. */
-                milliseconds = 0;
-            }
-        } else {
-            milliseconds = expire;
-        }
-
-        RedisModule_SetExpire(key, milliseconds);
-    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
-        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
-    }
+    tair_string_obj = tairStringStore(key, argv[2], ex_flags, version, flags, expire_p ? &expire : NULL, &milliseconds);
 
     /* Rewrite relative value to absolute value. */
     // 将相对值，转成绝对值。
@@ -377,7 +222,18 @@ int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
     RedisModule_Replicate(ctx, "EXSET", "v", v, vlen);
     RedisModule_Free(v);
 
-    if (ex_flags & TAIR_STRING_RETURN_WITH_VER) {
+    if (ex_flags & TAIR_STRING_SET_GET) {
+        RedisModule_ReplyWithArray(ctx, 2);
+        if (old_value) {
+            RedisModule_ReplyWithArray(ctx, 2);
+            RedisModule_ReplyWithString(ctx, old_value);
+            RedisModule_ReplyWithLongLong(ctx, old_version);
+            RedisModule_FreeString(NULL, old_value);
+        } else {
+            RedisModule_ReplyWithNull(ctx);
+        }
+        RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    } else if (ex_flags & TAIR_STRING_RETURN_WITH_VER) {
         RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
     } else {
         RedisModule_ReplyWithSimpleString(ctx, "OK");
@@ -386,17 +242,182 @@ int TairStringTypeSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
     return REDISMODULE_OK;
 }
 
-/* EXGET <key> [WITHFLAGS] */
+/* One key of an EXMSET, with the state the earlier keys of the command leave
+ * it in. */
+typedef struct TairStringMSetArg {
+    RedisModuleString *key, *value;
+    int ex_flags;
+    long long expire, version, flags;
+    int has_expire;
+    int exists;
+    uint64_t cur_version;
+} TairStringMSetArg;
+
+/* EXMSET <key> <value> <numopts> [EX/EXAT/PX/PXAT time] [NX/XX] [VER/ABS version] [FLAGS flags] [KEEPTTL]
+ *        [<key> <value> <numopts> [options] ...]
+ * The options of a key follow its value, after the count of their arguments,
+ * so a key or value named like an option is never taken for one. Every
+ * precondition is checked before
+ * anything is written: if one fails, the reply is the one EXSET gives for that
+ * key and no key is changed. Replies with the new versions, and replicates
+ * as a single EXMSET with absolute versions and expires. */
+int TairStringTypeMSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    /* Before any reply: a keys position request has no client to reply to.
+     * A malformed command has no keys, it fails before touching any. */
+    int i, j, n = 0;
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (j = 1; j > 0 && j + 2 < argc; j = tairStringCountedOptionsEnd(argv, argc, j + 2))
+            ;
+        for (i = 1; j == argc && i < argc; i = tairStringCountedOptionsEnd(argv, argc, i + 2)) {
+            RedisModule_KeyAtPos(ctx, i);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX |
+                               TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER |
+                               TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_SET_WITH_FLAGS;
+    TairStringMSetArg *args = RedisModule_PoolAlloc(ctx, sizeof(*args) * (argc / 3));
+
+    for (j = 1; j < argc; n++) {
+        TairStringMSetArg *a = &args[n];
+        RedisModuleString *expire_p = NULL, *version_p = NULL, *flags_p = NULL;
+        int end;
+
+        if (j + 2 >= argc) {
+            return RedisModule_WrongArity(ctx);
+        }
+        if ((end = tairStringCountedOptionsEnd(argv, argc, j + 2)) == -1) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        a->key = argv[j];
+        a->value = argv[j + 1];
+        a->ex_flags = TAIR_STRING_SET_NO_FLAGS;
+        a->expire = a->version = a->flags = 0;
+        if (parseAndGetExFlags(argv, end, j + 3, &a->ex_flags, &expire_p, &version_p, &flags_p, NULL, NULL, NULL,
+                               allow_flags) != REDISMODULE_OK) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        if ((expire_p && RedisModule_StringToLongLong(expire_p, &a->expire) != REDISMODULE_OK) ||
+            (version_p && RedisModule_StringToLongLong(version_p, &a->version) != REDISMODULE_OK) ||
+            (flags_p && RedisModule_StringToLongLong(flags_p, &a->flags) != REDISMODULE_OK) ||
+            (expire_p && a->expire <= 0) || a->version < 0 || a->flags < 0 || a->flags > UINT_MAX) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        a->has_expire = expire_p != NULL;
+        j = end;
+    }
+
+    /* Check every key, a key given twice is checked against what the earlier
+     * occurrence writes. */
+    for (i = 0; i < n; i++) {
+        TairStringMSetArg *a = &args[i];
+        for (j = i - 1; j >= 0 && RedisModule_StringCompare(args[j].key, a->key); j--)
+            ;
+        if (j >= 0) {
+            a->exists = 1;
+            a->cur_version = tairStringNextVersion(args[j].ex_flags, args[j].version, args[j].cur_version);
+        } else {
+            RedisModuleKey *key = RedisModule_OpenKey(ctx, a->key, REDISMODULE_READ);
+            a->exists = RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY;
+            if (a->exists && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+                RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+                return REDISMODULE_ERR;
+            }
+            a->cur_version = a->exists ? ((TairStringObj *)RedisModule_ModuleTypeGetValue(key))->version : 0;
+            RedisModule_CloseKey(key);
+        }
+
+        if ((a->exists && (a->ex_flags & TAIR_STRING_SET_NX)) || (!a->exists && (a->ex_flags & TAIR_STRING_SET_XX))) {
+            RedisModule_ReplyWithNull(ctx);
+            return REDISMODULE_ERR;
+        }
+        if (a->exists && !tairStringVersionMatches(a->ex_flags, a->version, a->cur_version)) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    /* key value numopts ABS version [PXAT time] [FLAGS flags] [KEEPTTL] per key. */
+    RedisModuleString **v = RedisModule_PoolAlloc(ctx, sizeof(RedisModuleString *) * 10 * n);
+    size_t vlen = 0, numopts;
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < n; i++) {
+        TairStringMSetArg *a = &args[i];
+        long long milliseconds = 0;
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, a->key, REDISMODULE_READ | REDISMODULE_WRITE);
+        TairStringObj *o = tairStringStore(key, a->value, a->ex_flags, a->version, a->flags,
+                                           a->has_expire ? &a->expire : NULL, &milliseconds);
+
+        v[vlen++] = a->key;
+        /* A copy: the stored value may be appended to in place later. */
+        v[vlen++] = RedisModule_CreateStringFromString(ctx, a->value);
+        numopts = vlen++;
+        v[vlen++] = RedisModule_CreateString(ctx, "ABS", 3);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, o->version);
+        if (a->has_expire) {
+            v[vlen++] = RedisModule_CreateString(ctx, "PXAT", 4);
+            v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, milliseconds + RedisModule_Milliseconds());
+        }
+        if (a->ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
+            v[vlen++] = RedisModule_CreateString(ctx, "FLAGS", 5);
+            v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, (long long)o->flags);
+        }
+        if (a->ex_flags & TAIR_STRING_SET_KEEPTTL) {
+            v[vlen++] = RedisModule_CreateString(ctx, "KEEPTTL", 7);
+        }
+        v[numopts] = RedisModule_CreateStringFromLongLong(ctx, (long long)(vlen - numopts - 1));
+        RedisModule_ReplyWithLongLong(ctx, o->version);
+        RedisModule_CloseKey(key);
+    }
+    RedisModule_Replicate(ctx, "EXMSET", "v", v, vlen);
+
+    return REDISMODULE_OK;
+}
+
+/* EXGET <key> [WITHFLAGS] [IFNEWER version]
+ * With IFNEWER, a key whose version is still the given one (the one the
+ * client has cached) replies NOT_MODIFIED instead of its value. */
 int TairStringTypeGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
-    // 只支持 2 个或者3个参数。
-    if (argc < 2 || argc > 3) {
+    if (argc < 2) {
         return RedisModule_WrongArity(ctx);
     }
-    // 文档中没有这个了。
-    if (argc == 3 && mstringcasecmp(argv[2], "withflags")) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+
+    /* Besides IFNEWER and its version, only WITHFLAGS may be given. */
+    int j, ifnewer = 0, withflags = 0;
+    for (j = 2; j + 1 < argc && !ifnewer; j++) {
+        if (!mstringcasecmp(argv[j], "ifnewer")) {
+            ifnewer = j;
+        }
+    }
+    if (argc - 2 - (ifnewer ? 2 : 0) > 1) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    long long cached_version = 0;
+    for (j = 2; j < argc; j++) {
+        if (j == ifnewer) {
+            if (RedisModule_StringToLongLong(argv[++j], &cached_version) != REDISMODULE_OK) {
+                RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VER_INT);
+                return REDISMODULE_ERR;
+            }
+        } else if (!mstringcasecmp(argv[j], "withflags")) {
+            withflags = 1;
+        } else {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
     }
 
     RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
@@ -411,12 +432,15 @@ int TairStringTypeGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
     }
     // get命令还是简单一些哦。 哈哈哈。
     TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
-    if (argc == 2) {
+    if (ifnewer && o->version == (uint64_t)cached_version) {
+        /* Not modified, spare the transfer of the value. */
+        RedisModule_ReplyWithSimpleString(ctx, TAIRSTRING_STATUSMSG_NOT_MODIFIED);
+    } else if (!withflags) {
         // 熟悉的感觉，往cmd中添加响应的数据。
         RedisModule_ReplyWithArray(ctx, 2);
         RedisModule_ReplyWithString(ctx, o->value);
         RedisModule_ReplyWithLongLong(ctx, o->version);
-    } else { /* argc == 3, WITHFLAGS .*/
+    } else {
         RedisModule_ReplyWithArray(ctx, 3);
         RedisModule_ReplyWithString(ctx, o->value);
         RedisModule_ReplyWithLongLong(ctx, o->version);
@@ -426,100 +450,164 @@ int TairStringTypeGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv
     return REDISMODULE_OK;
 }
 
-/* EXINCRBY <key> <num> [DEF default_value] [EX/EXAT/PX/PXAT time] [NX/XX]
- * [VER/ABS version] [MIN/MAX maxval] [NONEGATIVE] [WITHVERSION] [KEEPTTL] */
-int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+/* EXMGET <key> [<key> ...] [WITHFLAGS]
+ * A trailing WITHFLAGS is the option, not a key. Missing keys and keys of
+ * another type are returned as nil. */
+int TairStringTypeMGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
-    if (argc < 3) {
+    int withflags = argc > 2 && !mstringcasecmp(argv[argc - 1], "withflags");
+    int j, nkeys = argc - 1 - withflags;
+
+    /* Before the arity check, a keys position request has no client. */
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (j = 1; j <= nkeys; j++) {
+            RedisModule_KeyAtPos(ctx, j);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 2) {
         return RedisModule_WrongArity(ctx);
     }
 
-    long long min = 0, max = 0, value, incr, defaultvalue = 0; /* If DEF is not set, then defaultvalue = 0 .*/
-    RedisModuleString *min_p = NULL, *max_p = NULL;
-    long long milliseconds = 0, expire = 0, version = 0;
-    RedisModuleString *expire_p = NULL, *version_p = NULL, *defaultvalue_p = NULL;
+    RedisModule_ReplyWithArray(ctx, nkeys);
+    for (j = 1; j <= nkeys; j++) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[j], REDISMODULE_READ);
+        if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY || RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithNull(ctx);
+            RedisModule_CloseKey(key);
+            continue;
+        }
 
-    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
-    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | 
-                      TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER |
-                      TAIR_STRING_SET_WITH_ABS_VER  | TAIR_STRING_RETURN_WITH_VER | TAIR_STRING_SET_WITH_DEF |
-                      TAIR_STRING_SET_NONEGATIVE | TAIR_STRING_SET_WITH_BOUNDARY;
-    // 这些指针获取的什么？ 为啥要用指针？ 
-    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, &expire_p, &version_p, NULL, &defaultvalue_p, &min_p, &max_p, allow_flags) != REDISMODULE_OK) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+        TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
+        RedisModule_ReplyWithArray(ctx, withflags ? 3 : 2);
+        RedisModule_ReplyWithString(ctx, o->value);
+        RedisModule_ReplyWithLongLong(ctx, o->version);
+        if (withflags) {
+            RedisModule_ReplyWithLongLong(ctx, (long long)o->flags);
+        }
+        RedisModule_CloseKey(key);
     }
 
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
-    int type = RedisModule_KeyType(key);
-    if (REDISMODULE_KEYTYPE_EMPTY != type && RedisModule_ModuleTypeGetType(key) != TairStringType) {
-        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
-        return REDISMODULE_ERR;
-    }
+    return REDISMODULE_OK;
+}
 
-    if (RedisModule_StringToLongLong(argv[2], &incr) != REDISMODULE_OK) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
-        return REDISMODULE_ERR;
-    }
+/* Reply with [version, flags] of the exstrtype in 'key', and its remaining
+ * TTL in milliseconds (-1 without expire) with 'withttl'. */
+static void tairStringReplyWithVersion(RedisModuleCtx *ctx, RedisModuleKey *key, int withttl) {
+    TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
 
-    if ((NULL != defaultvalue_p) && (RedisModule_StringToLongLong(defaultvalue_p, &defaultvalue) != REDISMODULE_OK)) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
-        return REDISMODULE_ERR;
+    RedisModule_ReplyWithArray(ctx, withttl ? 3 : 2);
+    RedisModule_ReplyWithLongLong(ctx, o->version);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->flags);
+    if (withttl) {
+        RedisModule_ReplyWithLongLong(ctx, RedisModule_GetExpire(key));
     }
+}
 
-    if ((NULL != expire_p) && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK)) {
+/* EXGETVER <key> [WITHTTL]
+ * EXGET without the value: replies [version, flags] and with WITHTTL the
+ * remaining TTL in milliseconds, for clients that only revalidate. */
+int TairStringTypeGetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 2 || argc > 3) {
+        return RedisModule_WrongArity(ctx);
+    }
+    if (argc == 3 && mstringcasecmp(argv[2], "withttl")) {
         RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
         return REDISMODULE_ERR;
     }
 
-    if ((NULL != version_p) && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK)) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
     }
 
-    if ((expire_p && expire <=0) || version < 0) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithNull(ctx);
+        return REDISMODULE_OK;
     }
 
-    if ((NULL != min_p) && (RedisModule_StringToLongLong(min_p, &min))) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
-        return REDISMODULE_ERR;
+    tairStringReplyWithVersion(ctx, key, argc == 3);
+    return REDISMODULE_OK;
+}
+
+/* EXMGETVER <key> [<key> ...] [WITHTTL]
+ * EXGETVER for several keys. A trailing WITHTTL is the option, not a key.
+ * Missing keys and keys of another type are returned as nil. */
+int TairStringTypeMGetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    int withttl = argc > 2 && !mstringcasecmp(argv[argc - 1], "withttl");
+    int j, nkeys = argc - 1 - withttl;
+
+    /* Before the arity check, a keys position request has no client. */
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (j = 1; j <= nkeys; j++) {
+            RedisModule_KeyAtPos(ctx, j);
+        }
+        return REDISMODULE_OK;
     }
 
-    if ((NULL != max_p) && (RedisModule_StringToLongLong(max_p, &max))) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
-        return REDISMODULE_ERR;
+    if (argc < 2) {
+        return RedisModule_WrongArity(ctx);
     }
 
-    if (NULL != min_p && NULL != max_p && max < min) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
-        return REDISMODULE_ERR;
+    RedisModule_ReplyWithArray(ctx, nkeys);
+    for (j = 1; j <= nkeys; j++) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[j], REDISMODULE_READ);
+        if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY || RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithNull(ctx);
+        } else {
+            tairStringReplyWithVersion(ctx, key, withttl);
+        }
+        RedisModule_CloseKey(key);
     }
 
+    return REDISMODULE_OK;
+}
+
+/* The parsed options of an EXINCRBY on one key. */
+typedef struct TairStringIncrByArgs {
+    int ex_flags;
+    long long incr, version, defaultvalue;
+    long long min, max, expire;
+    int has_min, has_max, has_expire;
+} TairStringIncrByArgs;
+
+/* Apply an EXINCRBY to a key opened for writing that is empty or holds an
+ * exstrtype: NX/XX, VER, DEF, the overflow and MIN/MAX checks and NONEGATIVE,
+ * then the new value, version and expire. On failure nothing is changed and
+ * '*err' is the error to reply, or NULL when the reply is nil. */
+static int tairStringIncrByKey(RedisModuleKey *key, const TairStringIncrByArgs *a, TairStringObj **obj,
+                               long long *result, long long *milliseconds, const char **err) {
+    int type = RedisModule_KeyType(key), ex_flags = a->ex_flags;
     TairStringObj *tair_string_obj = NULL;
+    long long value;
+
+    *err = NULL;
     if (type == REDISMODULE_KEYTYPE_EMPTY) {
         if (ex_flags & TAIR_STRING_SET_XX) {
-            RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
         tair_string_obj = createTairStringTypeObject();
-        value = defaultvalue;
+        value = a->defaultvalue;
     } else {
         if (ex_flags & TAIR_STRING_SET_NX) {
-            RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
 
         tair_string_obj = RedisModule_ModuleTypeGetValue(key);
         if (RedisModule_StringToLongLong(tair_string_obj->value, &value) != REDISMODULE_OK) {
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
+            *err = TAIRSTRING_ERRORMSG_NO_INT;
             return REDISMODULE_ERR;
         }
 
-        if (ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && version != tair_string_obj->version) {
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
+        if (!tairStringVersionMatches(ex_flags, a->version, tair_string_obj->version)) {
+            *err = TAIRSTRING_ERRORMSG_VERSION;
             return REDISMODULE_ERR;
         }
     }
@@ -530,17 +618,14 @@ int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **a
      * "won't return ERR" = "no need to release object".
      * */
     if (!(ex_flags & TAIR_STRING_SET_WITH_DEF && type == REDISMODULE_KEYTYPE_EMPTY)) {
-        /* Check overflow. */
-        if ((incr < 0 && value < 0 && incr < (LLONG_MIN - value))
-            || (incr > 0 && value > 0 && incr > (LLONG_MAX - value)) || (max_p != NULL && value + incr > max)
-            || (min_p != NULL && value + incr < min)) {
+        if (tairStringIncrBy(value, a->incr, a->has_min ? &a->min : NULL, a->has_max ? &a->max : NULL, &value) !=
+            REDISMODULE_OK) {
             /* If type == EMPTY, then the tair_string_obj is created, so it
              * should be released here. */
             if (type == REDISMODULE_KEYTYPE_EMPTY && tair_string_obj) TairStringTypeReleaseObject(tair_string_obj);
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_OVERFLOW);
+            *err = TAIRSTRING_ERRORMSG_OVERFLOW;
             return REDISMODULE_ERR;
         }
-        value += incr;
     }
 
     /* value shouldn't be negative if NONEGATIVE is set; if value is negative,
@@ -549,7 +634,7 @@ int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **a
 
     if (type != REDISMODULE_KEYTYPE_EMPTY) {
         if (tair_string_obj->value) {
-            RedisModule_FreeString(ctx, tair_string_obj->value);
+            RedisModule_FreeString(NULL, tair_string_obj->value);
             tair_string_obj->value = NULL;
         }
     } else {
@@ -558,30 +643,105 @@ int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **a
 
     tair_string_obj->value = RedisModule_CreateStringFromLongLong(NULL, value);
 
-    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
-        tair_string_obj->version = version;
-    } else {
-        /* If the key doesn't exist and default is set, the version should be 1
-         * although the value won't increase. */
-        tair_string_obj->version++;
+    /* If the key doesn't exist and default is set, the version should be 1
+     * although the value won't increase. */
+    tair_string_obj->version = tairStringNextVersion(ex_flags, a->version, tair_string_obj->version);
+
+    if (a->has_expire) {
+        *milliseconds = tairStringRelativeExpire(ex_flags, a->expire, RedisModule_Milliseconds());
+        RedisModule_SetExpire(key, *milliseconds);
+    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
+        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
     }
 
-    if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
-        }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                milliseconds = 0;
-            }
+    *obj = tair_string_obj;
+    *result = value;
+    return REDISMODULE_OK;
+}
+
+/* EXINCRBY <key> <num> [DEF default_value] [EX/EXAT/PX/PXAT time] [NX/XX]
+ * [VER/ABS version] [MIN/MAX maxval] [NONEGATIVE] [WITHVERSION] [KEEPTTL] */
+int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 3) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    long long min = 0, max = 0, value, incr, defaultvalue = 0; /* If DEF is not set, then defaultvalue = 0 .*/
+    RedisModuleString *min_p = NULL, *max_p = NULL;
+    long long milliseconds = 0, expire = 0, version = 0;
+    RedisModuleString *expire_p = NULL, *version_p = NULL, *defaultvalue_p = NULL;
+
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | 
+                      TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER |
+                      TAIR_STRING_SET_WITH_ABS_VER  | TAIR_STRING_RETURN_WITH_VER | TAIR_STRING_SET_WITH_DEF |
+                      TAIR_STRING_SET_NONEGATIVE | TAIR_STRING_SET_WITH_BOUNDARY;
+    // 这些指针获取的什么？ 为啥要用指针？ 
+    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, &expire_p, &version_p, NULL, &defaultvalue_p, &min_p, &max_p, allow_flags) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (REDISMODULE_KEYTYPE_EMPTY != type && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    if (RedisModule_StringToLongLong(argv[2], &incr) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != defaultvalue_p) && (RedisModule_StringToLongLong(defaultvalue_p, &defaultvalue) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != expire_p) && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != version_p) && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((expire_p && expire <=0) || version < 0) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != min_p) && (RedisModule_StringToLongLong(min_p, &min))) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != max_p) && (RedisModule_StringToLongLong(max_p, &max))) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
+        return REDISMODULE_ERR;
+    }
+
+    if (NULL != min_p && NULL != max_p && max < min) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MIN_MAX);
+        return REDISMODULE_ERR;
+    }
+
+    TairStringObj *tair_string_obj = NULL;
+    const char *err = NULL;
+    TairStringIncrByArgs args = {ex_flags, incr, version, defaultvalue, min, max, expire,
+                                 min_p != NULL, max_p != NULL, expire_p != NULL};
+    if (tairStringIncrByKey(key, &args, &tair_string_obj, &value, &milliseconds, &err) != REDISMODULE_OK) {
+        if (err) {
+            RedisModule_ReplyWithError(ctx, err);
         } else {
-            milliseconds = expire;
+            RedisModule_ReplyWithNull(ctx);
         }
-
-        RedisModule_SetExpire(key, milliseconds);
-    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
-        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
+        return REDISMODULE_ERR;
     }
 
     if (expire_p) {
@@ -601,6 +761,176 @@ int TairStringTypeIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **a
     return REDISMODULE_OK;
 }
 
+/* Parse EXMINCRBY options, argv[start] to argv[end - 1], on top of 'base'
+ * (NULL for the options shared by every key): an expire or KEEPTTL replaces
+ * the shared one, DEF, MIN and MAX replace the shared value. Returns the error
+ * to reply, or NULL. */
+static const char *tairStringParseMIncrByOptions(RedisModuleString **argv, int start, int end,
+                                                 const TairStringIncrByArgs *base, TairStringIncrByArgs *a) {
+    RedisModuleString *expire_p = NULL, *defaultvalue_p = NULL, *min_p = NULL, *max_p = NULL;
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE |
+                               TAIR_STRING_SET_KEEPTTL | TAIR_STRING_RETURN_WITH_VER | TAIR_STRING_SET_WITH_DEF |
+                               TAIR_STRING_SET_NONEGATIVE | TAIR_STRING_SET_WITH_BOUNDARY;
+
+    if (parseAndGetExFlags(argv, end, start, &ex_flags, &expire_p, NULL, NULL, &defaultvalue_p, &min_p, &max_p,
+                           allow_flags) != REDISMODULE_OK) {
+        return TAIRSTRING_ERRORMSG_SYNTAX;
+    }
+
+    if (base) {
+        *a = *base;
+    } else {
+        memset(a, 0, sizeof(*a));
+    }
+    if (expire_p || (ex_flags & TAIR_STRING_SET_KEEPTTL)) {
+        a->ex_flags &= ~(TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL);
+        a->has_expire = 0;
+    }
+    a->ex_flags |= ex_flags;
+
+    if (expire_p) {
+        if (RedisModule_StringToLongLong(expire_p, &a->expire) != REDISMODULE_OK || a->expire <= 0) {
+            return TAIRSTRING_ERRORMSG_SYNTAX;
+        }
+        a->has_expire = 1;
+    }
+    if (defaultvalue_p && RedisModule_StringToLongLong(defaultvalue_p, &a->defaultvalue) != REDISMODULE_OK) {
+        return TAIRSTRING_ERRORMSG_NO_INT;
+    }
+    if (min_p) {
+        if (RedisModule_StringToLongLong(min_p, &a->min) != REDISMODULE_OK) {
+            return TAIRSTRING_ERRORMSG_MIN_MAX;
+        }
+        a->has_min = 1;
+    }
+    if (max_p) {
+        if (RedisModule_StringToLongLong(max_p, &a->max) != REDISMODULE_OK) {
+            return TAIRSTRING_ERRORMSG_MIN_MAX;
+        }
+        a->has_max = 1;
+    }
+    if (a->has_min && a->has_max && a->max < a->min) {
+        return TAIRSTRING_ERRORMSG_MIN_MAX;
+    }
+    return NULL;
+}
+
+/* EXMINCRBY <numopts> [options] <key> <num> <numopts> [options] [<key> <num> <numopts> [options] ...]
+ * options: [DEF default_value] [MIN minval] [MAX maxval] [NONEGATIVE]
+ *          [EX/EXAT/PX/PXAT time] [KEEPTTL] [WITHVERSION]
+ * Every list of options starts with the count of its arguments. The options
+ * before the first key apply to every key, the ones after the num of a key to
+ * that key only, overriding the shared ones. The keys are
+ * incremented in order and independently: a key that cannot be incremented
+ * (wrong type, not an integer, overflow, out of MIN/MAX) gets an error in the
+ * reply and is left unchanged. The new values replicate as a single EXMSET. */
+int TairStringTypeMIncrBy_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    /* As EXMSET, keys are reported before any reply and only for a well
+     * formed command. */
+    int i, j, n = 0, start = tairStringCountedOptionsEnd(argv, argc, 1);
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (j = start; j > 0 && j + 2 < argc; j = tairStringCountedOptionsEnd(argv, argc, j + 2))
+            ;
+        for (i = start; j == argc && i < argc; i = tairStringCountedOptionsEnd(argv, argc, i + 2)) {
+            RedisModule_KeyAtPos(ctx, i);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 5) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (start == -1) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+    TairStringIncrByArgs shared;
+    TairStringIncrByArgs *args = RedisModule_PoolAlloc(ctx, sizeof(*args) * (argc / 3));
+    const char *err = tairStringParseMIncrByOptions(argv, 2, start, NULL, &shared);
+    if (err) {
+        RedisModule_ReplyWithError(ctx, err);
+        return REDISMODULE_ERR;
+    }
+
+    if (start + 2 >= argc) {
+        return RedisModule_WrongArity(ctx);
+    }
+    for (j = start; j < argc; n++) {
+        int end;
+        if (j + 2 >= argc) {
+            return RedisModule_WrongArity(ctx);
+        }
+        if ((end = tairStringCountedOptionsEnd(argv, argc, j + 2)) == -1) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        err = tairStringParseMIncrByOptions(argv, j + 3, end, &shared, &args[n]);
+        if (!err && RedisModule_StringToLongLong(argv[j + 1], &args[n].incr) != REDISMODULE_OK) {
+            err = TAIRSTRING_ERRORMSG_NO_INT;
+        }
+        if (err) {
+            RedisModule_ReplyWithError(ctx, err);
+            return REDISMODULE_ERR;
+        }
+        j = end;
+    }
+
+    /* key value numopts ABS version [PXAT time] [KEEPTTL] per key. */
+    RedisModuleString **v = RedisModule_PoolAlloc(ctx, sizeof(RedisModuleString *) * 8 * n);
+    size_t vlen = 0, numopts;
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0, j = start; i < n; i++, j = tairStringCountedOptionsEnd(argv, argc, j + 2)) {
+        TairStringIncrByArgs *a = &args[i];
+        TairStringObj *o = NULL;
+        long long value, milliseconds = 0;
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[j], REDISMODULE_READ | REDISMODULE_WRITE);
+
+        if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            RedisModule_CloseKey(key);
+            continue;
+        }
+        if (tairStringIncrByKey(key, a, &o, &value, &milliseconds, &err) != REDISMODULE_OK) {
+            RedisModule_ReplyWithError(ctx, err ? err : TAIRSTRING_ERRORMSG_SYNTAX);
+            RedisModule_CloseKey(key);
+            continue;
+        }
+
+        v[vlen++] = argv[j];
+        /* A later occurrence of the same key frees this value. */
+        v[vlen++] = RedisModule_CreateStringFromString(ctx, o->value);
+        numopts = vlen++;
+        v[vlen++] = RedisModule_CreateString(ctx, "ABS", 3);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, o->version);
+        if (a->has_expire) {
+            v[vlen++] = RedisModule_CreateString(ctx, "PXAT", 4);
+            v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, milliseconds + RedisModule_Milliseconds());
+        } else if (a->ex_flags & TAIR_STRING_SET_KEEPTTL) {
+            v[vlen++] = RedisModule_CreateString(ctx, "KEEPTTL", 7);
+        }
+        v[numopts] = RedisModule_CreateStringFromLongLong(ctx, (long long)(vlen - numopts - 1));
+
+        if (a->ex_flags & TAIR_STRING_RETURN_WITH_VER) {
+            RedisModule_ReplyWithArray(ctx, 2);
+            RedisModule_ReplyWithLongLong(ctx, value);
+            RedisModule_ReplyWithLongLong(ctx, o->version);
+        } else {
+            RedisModule_ReplyWithLongLong(ctx, value);
+        }
+        RedisModule_CloseKey(key);
+    }
+    if (vlen) {
+        RedisModule_Replicate(ctx, "EXMSET", "v", v, vlen);
+    }
+
+    return REDISMODULE_OK;
+}
+
 /* EXINCRBYFLOAT <key> <num> [MIN/MAX maxval] [EX/EXAT/PX/PXAT time] [NX/XX] [VER/ABS version] [KEEPTTL] */
 int TairStringTypeIncrByFloat_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
@@ -609,7 +939,7 @@ int TairStringTypeIncrByFloat_RedisCommand(RedisModuleCtx *ctx, RedisModuleStrin
         return RedisModule_WrongArity(ctx);
     }
 
-    long double min = 0, max = 0, value, oldvalue, incr;
+    long double min = 0, max = 0, value, incr;
     RedisModuleString *min_p = NULL, *max_p = NULL;
     long long milliseconds = 0, expire = 0, version = 0;
     RedisModuleString *expire_p = NULL, *version_p = NULL;
@@ -685,31 +1015,22 @@ int TairStringTypeIncrByFloat_RedisCommand(RedisModuleCtx *ctx, RedisModuleStrin
             return REDISMODULE_ERR;
         }
 
-        if (ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && version != tair_string_obj->version) {
+        if (!tairStringVersionMatches(ex_flags, version, tair_string_obj->version)) {
             RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
             return REDISMODULE_ERR;
         }
     }
 
-    oldvalue = value;
-
-    if (isnan(oldvalue + incr) || isinf(oldvalue + incr) || (max_p != NULL && oldvalue + incr > max)
-        || (min_p != NULL && oldvalue + incr < min)) {
+    if (tairStringIncrByFloat(value, incr, min_p ? &min : NULL, max_p ? &max : NULL, &value) != REDISMODULE_OK) {
         if (type == REDISMODULE_KEYTYPE_EMPTY && tair_string_obj) TairStringTypeReleaseObject(tair_string_obj);
         RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_OVERFLOW);
         return REDISMODULE_ERR;
     }
 
-    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
-        tair_string_obj->version = version;
-    } else {
-        tair_string_obj->version++;
-    }
-
-    value += incr;
+    tair_string_obj->version = tairStringNextVersion(ex_flags, version, tair_string_obj->version);
 
     char dbuf[MAX_LONG_DOUBLE_CHARS];
-    int dlen = m_ld2string(dbuf, sizeof(dbuf), value, 1);
+    int dlen = tairStringEncodeFloat(dbuf, sizeof(dbuf), value);
 
     if (type != REDISMODULE_KEYTYPE_EMPTY) {
         if (tair_string_obj->value) {
@@ -722,18 +1043,7 @@ int TairStringTypeIncrByFloat_RedisCommand(RedisModuleCtx *ctx, RedisModuleStrin
     tair_string_obj->value = RedisModule_CreateString(NULL, dbuf, dlen);
 
     if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
-        }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                milliseconds = 0;
-            }
-        } else {
-            milliseconds = expire;
-        }
-
+        milliseconds = tairStringRelativeExpire(ex_flags, expire, RedisModule_Milliseconds());
         RedisModule_SetExpire(key, milliseconds);
     } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
         RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
@@ -791,7 +1101,9 @@ int TairStringTypeExSetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString *
     return REDISMODULE_OK;
 }
 
-/* EXCAS <key> <new_value> <version> [EX/EXAT/PX/PXAT time] [KEEPTTL] */
+/* EXCAS <key> <new_value> <version> [EX/EXAT/PX/PXAT time] [KEEPTTL] [NOVALUE | WITHVALUE IFSMALLER size]
+ * On a version mismatch the reply carries the current value, or nil instead
+ * with NOVALUE, or when the value is not smaller than 'size' bytes. */
 int TairStringTypeExCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
@@ -799,12 +1111,27 @@ int TairStringTypeExCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
         return RedisModule_WrongArity(ctx);
     }
 
+    /* NOVALUE or WITHVALUE IFSMALLER come last and only shape the mismatch
+     * reply, the options between them and the version are the EXSET ones. */
+    long long max_value_len = -1;
+    int novalue = 0, opts_end = argc;
+    if (argc > 4 && !mstringcasecmp(argv[argc - 1], "novalue")) {
+        novalue = 1;
+        opts_end = argc - 1;
+    } else if (argc > 6 && !mstringcasecmp(argv[argc - 3], "withvalue") && !mstringcasecmp(argv[argc - 2], "ifsmaller")) {
+        if (RedisModule_StringToLongLong(argv[argc - 1], &max_value_len) != REDISMODULE_OK || max_value_len < 0) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        opts_end = argc - 3;
+    }
+
     long long version = 0;
     long long milliseconds = 0, expire = 0;
     RedisModuleString *expire_p = NULL;
     int ex_flags = TAIR_STRING_SET_NO_FLAGS;
     unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL;
-    if (parseAndGetExFlags(argv, argc, 4, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+    if (parseAndGetExFlags(argv, opts_end, 4, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
         RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
         return REDISMODULE_ERR;
     }
@@ -845,7 +1172,13 @@ int TairStringTypeExCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
         will cause jedis throw an exception, and the client can not read the
         later version and value. */
         RedisModule_ReplyWithSimpleString(ctx, TAIRSTRING_STATUSMSG_VERSION);
-        RedisModule_ReplyWithString(ctx, tair_string_obj->value);
+        size_t value_len;
+        RedisModule_StringPtrLen(tair_string_obj->value, &value_len);
+        if (novalue || (max_value_len >= 0 && value_len >= (size_t)max_value_len)) {
+            RedisModule_ReplyWithNull(ctx);
+        } else {
+            RedisModule_ReplyWithString(ctx, tair_string_obj->value);
+        }
         RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
         RedisModule_ReplySetArrayLength(ctx, 3);
         return REDISMODULE_ERR;
@@ -860,18 +1193,7 @@ int TairStringTypeExCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
     tair_string_obj->version++;
 
     if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
-        }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                milliseconds = 0;
-            }
-        } else {
-            milliseconds = expire;
-        }
-
+        milliseconds = tairStringRelativeExpire(ex_flags, expire, RedisModule_Milliseconds());
         RedisModule_SetExpire(key, milliseconds);
     } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
         RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
@@ -892,6 +1214,23 @@ int TairStringTypeExCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
     return REDISMODULE_OK;
 }
 
+/* Delete a key opened for writing that is empty or holds an exstrtype if
+ * its version is 'version'. Returns -1 if the key does not exist, 0 if the
+ * version does not match, 1 if the key was deleted. */
+static int tairStringCadKey(RedisModuleKey *key, long long version) {
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+        return -1;
+    }
+
+    TairStringObj *tair_string_obj = RedisModule_ModuleTypeGetValue(key);
+    if (tair_string_obj->version != version) {
+        return 0;
+    }
+
+    RedisModule_DeleteKey(key);
+    return 1;
+}
+
 /* EXCAD <key> <version> */
 int TairStringTypeExCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
@@ -914,168 +1253,1031 @@ int TairStringTypeExCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
         return REDISMODULE_ERR;
     }
 
-    TairStringObj *tair_string_obj = NULL;
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        RedisModule_ReplyWithLongLong(ctx, -1);
-        return REDISMODULE_OK;
-    } else {
-        tair_string_obj = RedisModule_ModuleTypeGetValue(key);
-    }
-
-    if (tair_string_obj->version != version) {
-        RedisModule_ReplyWithLongLong(ctx, 0);
-        return REDISMODULE_OK;
+    int ret = tairStringCadKey(key, version);
+    if (ret == 1) {
+        RedisModule_Replicate(ctx, "DEL", "s", argv[1]);
     }
-
-    RedisModule_Replicate(ctx, "DEL", "s", argv[1]);
-    RedisModule_DeleteKey(key);
-    RedisModule_ReplyWithLongLong(ctx, 1);
+    RedisModule_ReplyWithLongLong(ctx, ret);
     return REDISMODULE_OK;
 }
 
-/* CAD <key> <value> */
-int StringTypeCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+/* EXMCAD <key> <version> [<key> <version> ...]
+ * An EXCAD per key, in order: replies -1, 0 or 1 per key as EXCAD does, or a
+ * WRONGTYPE error for a key of another type. The versions are all checked to
+ * be integers before any key is deleted. The deleted keys replicate as a
+ * single DEL. */
+int TairStringTypeExMCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
-    if (argc != 3) {
+    if (argc < 3 || argc % 2 == 0) {
         return RedisModule_WrongArity(ctx);
     }
 
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
-    int type = RedisModule_KeyType(key);
-    if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
-        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
-        return REDISMODULE_ERR;
+    int i, n = (argc - 1) / 2;
+    long long *versions = RedisModule_PoolAlloc(ctx, sizeof(long long) * n);
+    for (i = 0; i < n; i++) {
+        if (RedisModule_StringToLongLong(argv[2 + 2 * i], &versions[i]) != REDISMODULE_OK) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
     }
 
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        RedisModule_ReplyWithLongLong(ctx, -1);
-        return REDISMODULE_OK;
-    } else {
-        size_t proto_len, expect_len;
-        RedisModuleCallReply *replay = RedisModule_Call(ctx, "GET", "s", argv[1]);
-        switch (RedisModule_CallReplyType(replay)) {
-            case REDISMODULE_REPLY_STRING:
-                break;
-            default:
-                RedisModule_ReplyWithLongLong(ctx, 0);
-                return REDISMODULE_OK;
-        }
+    RedisModuleString **deleted = RedisModule_PoolAlloc(ctx, sizeof(RedisModuleString *) * n);
+    size_t ndeleted = 0;
 
-        const char *proto_ptr = RedisModule_CallReplyStringPtr(replay, &proto_len);
-        const char *expect_ptr = RedisModule_StringPtrLen(argv[2], &expect_len);
-        if (proto_len != expect_len || memcmp(expect_ptr, proto_ptr, proto_len) != 0) {
-            RedisModule_ReplyWithLongLong(ctx, 0);
-            return REDISMODULE_OK;
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < n; i++) {
+        RedisModuleString *keyname = argv[1 + 2 * i];
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ | REDISMODULE_WRITE);
+
+        if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        } else {
+            int ret = tairStringCadKey(key, versions[i]);
+            if (ret == 1) {
+                deleted[ndeleted++] = keyname;
+            }
+            RedisModule_ReplyWithLongLong(ctx, ret);
         }
+        RedisModule_CloseKey(key);
+    }
+    if (ndeleted) {
+        RedisModule_Replicate(ctx, "DEL", "v", deleted, ndeleted);
     }
 
-    RedisModule_DeleteKey(key);
-    RedisModule_Replicate(ctx, "DEL", "s", argv[1]);
-    RedisModule_ReplyWithLongLong(ctx, 1);
     return REDISMODULE_OK;
 }
 
-/* CAS <Key> <oldvalue> <newvalue> [EX/EXAT/PX/PXAT time] [KEEPTTL] */
-int StringTypeCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
-    RedisModule_AutoMemory(ctx);
+#define TXN_CMP_VERSION 0
+#define TXN_CMP_VALUE 1
+#define TXN_CMP_EXISTS 2
+#define TXN_CMP_NOTEXISTS 3
+
+#define TXN_OP_SET 0
+#define TXN_OP_INCRBY 1
+#define TXN_OP_DEL 2
+#define TXN_OP_GET 3
+
+/* A comparison of EXTXN, 'relation' is one of TXN_REL_* for VERSION and
+ * VALUE. */
+typedef struct TairStringTxnCmp {
+    int kind;
+    int keypos;
+    int relation;
+    RedisModuleString *arg;
+    long long version;
+} TairStringTxnCmp;
+
+/* An operation of EXTXN. SET uses ex_flags, version, expire and has_expire of
+ * 'args', INCRBY all of it. The check fills in the state of the key once the
+ * operation ran. */
+typedef struct TairStringTxnOp {
+    int kind;
+    int keypos;
+    RedisModuleString *value;
+    long long flags;
+    TairStringIncrByArgs args;
+    int exists;
+    uint64_t version;
+    RedisModuleString *new_value;
+} TairStringTxnOp;
+
+typedef struct TairStringTxn {
+    TairStringTxnCmp *cmps;
+    TairStringTxnOp *ops;
+    int ncmps, nthen, nops; /* ops[0, nthen) is THEN, ops[nthen, nops) ELSE. */
+} TairStringTxn;
+
+#define TXN_REL_EQ 0
+#define TXN_REL_NE 1
+#define TXN_REL_LT 2
+#define TXN_REL_GT 3
+
+static int tairStringTxnRelation(RedisModuleString *op) {
+    if (!mstringcasecmp(op, "==")) return TXN_REL_EQ;
+    if (!mstringcasecmp(op, "!=")) return TXN_REL_NE;
+    if (!mstringcasecmp(op, "<")) return TXN_REL_LT;
+    if (!mstringcasecmp(op, ">")) return TXN_REL_GT;
+    return -1;
+}
 
-    if (argc < 4) {
-        return RedisModule_WrongArity(ctx);
+static int tairStringTxnHolds(int relation, int cmp) {
+    switch (relation) {
+    case TXN_REL_EQ: return cmp == 0;
+    case TXN_REL_NE: return cmp != 0;
+    case TXN_REL_LT: return cmp < 0;
+    default: return cmp > 0;
     }
+}
 
-    long long milliseconds = 0, expire = 0;
-    RedisModuleString *expire_p = NULL;
-    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
-    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL;
-    if (parseAndGetExFlags(argv, argc, 4, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+/* EXTXN [<compare> ...] THEN [<op> ...] [ELSE [<op> ...]]
+ * Returns the error to reply, or NULL. */
+static const char *tairStringParseTxn(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, TairStringTxn *txn) {
+    int j = 1, in_else = 0;
+
+    txn->cmps = RedisModule_PoolAlloc(ctx, sizeof(TairStringTxnCmp) * (argc / 2 + 1));
+    txn->ops = RedisModule_PoolAlloc(ctx, sizeof(TairStringTxnOp) * (argc / 2 + 1));
+    txn->ncmps = txn->nthen = txn->nops = 0;
+
+    for (; j < argc && mstringcasecmp(argv[j], "then"); txn->ncmps++) {
+        TairStringTxnCmp *c = &txn->cmps[txn->ncmps];
+        memset(c, 0, sizeof(*c));
+        c->keypos = j + 1;
+        if (!mstringcasecmp(argv[j], "version") || !mstringcasecmp(argv[j], "value")) {
+            c->kind = mstringcasecmp(argv[j], "version") ? TXN_CMP_VALUE : TXN_CMP_VERSION;
+            if (j + 3 >= argc || (c->relation = tairStringTxnRelation(argv[j + 2])) == -1) {
+                return TAIRSTRING_ERRORMSG_SYNTAX;
+            }
+            c->arg = argv[j + 3];
+            if (c->kind == TXN_CMP_VERSION &&
+                (RedisModule_StringToLongLong(c->arg, &c->version) != REDISMODULE_OK || c->version < 0)) {
+                return TAIRSTRING_ERRORMSG_VER_INT;
+            }
+            j += 4;
+        } else if (!mstringcasecmp(argv[j], "exists") || !mstringcasecmp(argv[j], "notexists")) {
+            c->kind = mstringcasecmp(argv[j], "exists") ? TXN_CMP_NOTEXISTS : TXN_CMP_EXISTS;
+            if (j + 1 >= argc) {
+                return TAIRSTRING_ERRORMSG_SYNTAX;
+            }
+            j += 2;
+        } else {
+            return TAIRSTRING_ERRORMSG_SYNTAX;
+        }
     }
-
-    if ((NULL != expire_p) && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK)) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
+    if (j++ >= argc) {
+        return TAIRSTRING_ERRORMSG_SYNTAX;
     }
 
-    if ((expire_p && expire <=0)) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
-        return REDISMODULE_ERR;
-    }
+    while (j < argc) {
+        TairStringTxnOp *o = &txn->ops[txn->nops];
+        int end;
 
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
-    int type = RedisModule_KeyType(key);
-    if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
-        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
-        return REDISMODULE_ERR;
-    }
+        if (!mstringcasecmp(argv[j], "else")) {
+            if (in_else) {
+                return TAIRSTRING_ERRORMSG_SYNTAX;
+            }
+            in_else = 1;
+            txn->nthen = txn->nops;
+            j++;
+            continue;
+        }
 
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        RedisModule_ReplyWithLongLong(ctx, -1);
-        return REDISMODULE_OK;
-    } else {
-        size_t proto_len, expect_len;
-        RedisModuleCallReply *replay = RedisModule_Call(ctx, "GET", "s", argv[1]);
-        switch (RedisModule_CallReplyType(replay)) {
-            case REDISMODULE_REPLY_STRING:
+        memset(o, 0, sizeof(*o));
+        o->keypos = j + 1;
+        if (j + 1 >= argc) {
+            return TAIRSTRING_ERRORMSG_SYNTAX;
+        }
+        if (!mstringcasecmp(argv[j], "set") || !mstringcasecmp(argv[j], "incrby")) {
+            if ((end = tairStringCountedOptionsEnd(argv, argc, j + 3)) == -1) {
+                return TAIRSTRING_ERRORMSG_SYNTAX;
+            }
+            o->value = argv[j + 2];
+            if (!mstringcasecmp(argv[j], "set")) {
+                RedisModuleString *expire_p = NULL, *version_p = NULL, *flags_p = NULL;
+                unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE |
+                                           TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_ABS_VER |
+                                           TAIR_STRING_SET_WITH_FLAGS;
+                o->kind = TXN_OP_SET;
+                if (parseAndGetExFlags(argv, end, j + 4, &o->args.ex_flags, &expire_p, &version_p, &flags_p, NULL,
+                                       NULL, NULL, allow_flags) != REDISMODULE_OK ||
+                    (expire_p && RedisModule_StringToLongLong(expire_p, &o->args.expire) != REDISMODULE_OK) ||
+                    (version_p && RedisModule_StringToLongLong(version_p, &o->args.version) != REDISMODULE_OK) ||
+                    (flags_p && RedisModule_StringToLongLong(flags_p, &o->flags) != REDISMODULE_OK) ||
+                    (expire_p && o->args.expire <= 0) || o->args.version < 0 || o->flags < 0 || o->flags > UINT_MAX) {
+                    return TAIRSTRING_ERRORMSG_SYNTAX;
+                }
+                o->args.has_expire = expire_p != NULL;
+            } else {
+                const char *err = tairStringParseMIncrByOptions(argv, j + 4, end, NULL, &o->args);
+                o->kind = TXN_OP_INCRBY;
+                if (err) {
+                    return err;
+                }
+                if (RedisModule_StringToLongLong(o->value, &o->args.incr) != REDISMODULE_OK) {
+                    return TAIRSTRING_ERRORMSG_NO_INT;
+                }
+            }
+            j = end;
+        } else if (!mstringcasecmp(argv[j], "del") || !mstringcasecmp(argv[j], "get")) {
+            o->kind = mstringcasecmp(argv[j], "del") ? TXN_OP_GET : TXN_OP_DEL;
+            j += 2;
+        } else {
+            return TAIRSTRING_ERRORMSG_SYNTAX;
+        }
+        txn->nops++;
+    }
+    if (!in_else) {
+        txn->nthen = txn->nops;
+    }
+    return NULL;
+}
+
+/* The state of an exstrtype key in the keyspace. Returns REDISMODULE_ERR if
+ * the key holds another type. */
+static int tairStringKeyState(RedisModuleCtx *ctx, RedisModuleString *keyname, int *exists, uint64_t *version,
+                              RedisModuleString **value) {
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+    int ret = REDISMODULE_OK;
+
+    *exists = RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY;
+    *version = 0;
+    *value = NULL;
+    if (*exists) {
+        if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            ret = REDISMODULE_ERR;
+        } else {
+            TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
+            *version = o->version;
+            *value = o->value;
+        }
+    }
+    RedisModule_CloseKey(key);
+    return ret;
+}
+
+/* Run the operations from..to of the transaction on paper, in order, and
+ * record the state each one leaves, so that they are only applied if none of
+ * them can fail. Returns the error to reply, or NULL. */
+static const char *tairStringCheckTxnOps(RedisModuleCtx *ctx, RedisModuleString **argv, TairStringTxnOp *ops, int from,
+                                         int to) {
+    for (int i = from; i < to; i++) {
+        TairStringTxnOp *o = &ops[i];
+        RedisModuleString *value = NULL;
+        uint64_t version = 0;
+        int exists = 0, j;
+
+        /* An earlier operation on the same key, else the keyspace. */
+        for (j = i - 1; j >= from; j--) {
+            if (ops[j].kind != TXN_OP_GET && !RedisModule_StringCompare(argv[ops[j].keypos], argv[o->keypos])) {
+                exists = ops[j].exists;
+                version = ops[j].version;
+                value = ops[j].new_value;
                 break;
-            default:
-                RedisModule_ReplyWithLongLong(ctx, 0);
-                return REDISMODULE_OK;
+            }
+        }
+        if (j < from && tairStringKeyState(ctx, argv[o->keypos], &exists, &version, &value) != REDISMODULE_OK) {
+            return REDISMODULE_ERRORMSG_WRONGTYPE;
+        }
+
+        if (o->kind == TXN_OP_GET) {
+            o->exists = exists;
+            o->version = version;
+            o->new_value = value;
+        } else if (o->kind == TXN_OP_DEL) {
+            o->exists = 0;
+            o->version = 0;
+            o->new_value = NULL;
+        } else if (o->kind == TXN_OP_SET) {
+            o->exists = 1;
+            o->version = tairStringNextVersion(o->args.ex_flags, o->args.version, version);
+            o->new_value = o->value;
+        } else {
+            const TairStringIncrByArgs *a = &o->args;
+            long long v = a->defaultvalue;
+            if (exists && RedisModule_StringToLongLong(value, &v) != REDISMODULE_OK) {
+                return TAIRSTRING_ERRORMSG_NO_INT;
+            }
+            if (!(a->ex_flags & TAIR_STRING_SET_WITH_DEF && !exists) &&
+                tairStringIncrBy(v, a->incr, a->has_min ? &a->min : NULL, a->has_max ? &a->max : NULL, &v) !=
+                    REDISMODULE_OK) {
+                return TAIRSTRING_ERRORMSG_OVERFLOW;
+            }
+            if (a->ex_flags & TAIR_STRING_SET_NONEGATIVE) v = v < 0 ? 0LL : v;
+            o->exists = 1;
+            o->version = tairStringNextVersion(a->ex_flags, 0, version);
+            o->new_value = RedisModule_CreateStringFromLongLong(ctx, v);
         }
+    }
+    return NULL;
+}
+
+/* Apply one operation of the transaction, once the check passed, reply with
+ * its result and replicate it: SET and INCRBY as EXSET with the absolute
+ * version and expire, DEL as DEL. */
+static void tairStringApplyTxnOp(RedisModuleCtx *ctx, RedisModuleString **argv, const TairStringTxnOp *o) {
+    RedisModuleString *keyname = argv[o->keypos];
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ | REDISMODULE_WRITE);
+    long long value = 0, milliseconds = 0;
+    TairStringObj *obj = NULL;
+    const char *err = NULL;
+
+    if (o->kind == TXN_OP_GET) {
+        if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+            RedisModule_ReplyWithNull(ctx);
+        } else {
+            obj = RedisModule_ModuleTypeGetValue(key);
+            RedisModule_ReplyWithArray(ctx, 2);
+            RedisModule_ReplyWithString(ctx, obj->value);
+            RedisModule_ReplyWithLongLong(ctx, obj->version);
+        }
+        RedisModule_CloseKey(key);
+        return;
+    }
 
-        const char *proto_ptr = RedisModule_CallReplyStringPtr(replay, &proto_len);
-        const char *expect_ptr = RedisModule_StringPtrLen(argv[2], &expect_len);
-        if (proto_len != expect_len || memcmp(expect_ptr, proto_ptr, proto_len) != 0) {
+    if (o->kind == TXN_OP_DEL) {
+        if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
             RedisModule_ReplyWithLongLong(ctx, 0);
-            return REDISMODULE_OK;
+        } else {
+            RedisModule_DeleteKey(key);
+            RedisModule_Replicate(ctx, "DEL", "s", keyname);
+            RedisModule_ReplyWithLongLong(ctx, 1);
+        }
+        RedisModule_CloseKey(key);
+        return;
+    }
+
+    if (o->kind == TXN_OP_SET) {
+        obj = tairStringStore(key, o->value, o->args.ex_flags, o->args.version, o->flags,
+                              o->args.has_expire ? &o->args.expire : NULL, &milliseconds);
+    } else if (tairStringIncrByKey(key, &o->args, &obj, &value, &milliseconds, &err) != REDISMODULE_OK) {
+        /* Not reached, the check ran the same increment on the same state. */
+        RedisModule_ReplyWithError(ctx, err ? err : TAIRSTRING_ERRORMSG_SYNTAX);
+        RedisModule_CloseKey(key);
+        return;
+    }
+
+    /* key value ABS version [PXAT time] [FLAGS flags] [KEEPTTL] */
+    RedisModuleString *v[9];
+    size_t vlen = 0;
+    v[vlen++] = keyname;
+    /* A copy: the stored value may be appended to in place later. */
+    v[vlen++] = RedisModule_CreateStringFromString(ctx, obj->value);
+    v[vlen++] = RedisModule_CreateString(ctx, "ABS", 3);
+    v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, obj->version);
+    if (o->args.has_expire) {
+        v[vlen++] = RedisModule_CreateString(ctx, "PXAT", 4);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, milliseconds + RedisModule_Milliseconds());
+    }
+    if (o->args.ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
+        v[vlen++] = RedisModule_CreateString(ctx, "FLAGS", 5);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, (long long)obj->flags);
+    }
+    if (o->args.ex_flags & TAIR_STRING_SET_KEEPTTL) {
+        v[vlen++] = RedisModule_CreateString(ctx, "KEEPTTL", 7);
+    }
+    RedisModule_Replicate(ctx, "EXSET", "v", v, vlen);
+
+    if (o->kind == TXN_OP_SET) {
+        RedisModule_ReplyWithLongLong(ctx, obj->version);
+    } else if (o->args.ex_flags & TAIR_STRING_RETURN_WITH_VER) {
+        RedisModule_ReplyWithArray(ctx, 2);
+        RedisModule_ReplyWithLongLong(ctx, value);
+        RedisModule_ReplyWithLongLong(ctx, obj->version);
+    } else {
+        RedisModule_ReplyWithLongLong(ctx, value);
+    }
+    RedisModule_CloseKey(key);
+}
+
+/* EXTXN [<compare> ...] THEN [<op> ...] [ELSE [<op> ...]]
+ * compare: VERSION <key> ==|!=|<|> <version>
+ *          VALUE <key> ==|!=|<|> <value>
+ *          EXISTS <key> | NOTEXISTS <key>
+ * op:      SET <key> <value> <numopts> [EX/EXAT/PX/PXAT time] [ABS version] [FLAGS flags] [KEEPTTL]
+ *          INCRBY <key> <num> <numopts> [DEF default_value] [MIN minval] [MAX maxval] [NONEGATIVE]
+ *                 [EX/EXAT/PX/PXAT time] [KEEPTTL] [WITHVERSION]
+ *          DEL <key> | GET <key>
+ * numopts counts the option arguments of SET and INCRBY, so a value named
+ * like an option or an operation is never taken for one.
+ * If every compare holds the THEN operations run, else the ELSE ones, in
+ * order and atomically. A missing key has version 0 and no value, so only
+ * its VALUE != holds. The operations are checked before any of them runs: if
+ * one would fail (wrong type, not an integer, overflow) the error is the reply
+ * and nothing is changed. Replies [1|0, [result ...]], 1 when THEN ran. */
+int TairStringTypeTxn_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    TairStringTxn txn;
+    const char *err = tairStringParseTxn(ctx, argv, argc, &txn);
+    int i, succeeded = 1;
+
+    /* Before the arity check, a keys position request has no client. */
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        if (!err) {
+            for (i = 0; i < txn.ncmps; i++) RedisModule_KeyAtPos(ctx, txn.cmps[i].keypos);
+            for (i = 0; i < txn.nops; i++) RedisModule_KeyAtPos(ctx, txn.ops[i].keypos);
+        }
+        return REDISMODULE_OK;
+    }
+    if (argc < 2) {
+        return RedisModule_WrongArity(ctx);
+    }
+    if (err) {
+        RedisModule_ReplyWithError(ctx, err);
+        return REDISMODULE_ERR;
+    }
+
+    for (i = 0; i < txn.ncmps && succeeded; i++) {
+        TairStringTxnCmp *c = &txn.cmps[i];
+        RedisModuleString *value;
+        uint64_t version;
+        int exists;
+
+        if (tairStringKeyState(ctx, argv[c->keypos], &exists, &version, &value) != REDISMODULE_OK &&
+            (c->kind == TXN_CMP_VERSION || c->kind == TXN_CMP_VALUE)) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+        switch (c->kind) {
+        case TXN_CMP_VERSION:
+            succeeded = tairStringTxnHolds(c->relation, version < (uint64_t)c->version ? -1 : version > (uint64_t)c->version);
+            break;
+        case TXN_CMP_VALUE:
+            succeeded = value ? tairStringTxnHolds(c->relation, RedisModule_StringCompare(value, c->arg))
+                              : c->relation == TXN_REL_NE;
+            break;
+        case TXN_CMP_EXISTS:
+            succeeded = exists;
+            break;
+        default:
+            succeeded = !exists;
+            break;
         }
     }
 
+    int from = succeeded ? 0 : txn.nthen, to = succeeded ? txn.nthen : txn.nops;
+    if ((err = tairStringCheckTxnOps(ctx, argv, txn.ops, from, to))) {
+        RedisModule_ReplyWithError(ctx, err);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModule_ReplyWithArray(ctx, 2);
+    RedisModule_ReplyWithLongLong(ctx, succeeded);
+    RedisModule_ReplyWithArray(ctx, to - from);
+    for (i = from; i < to; i++) {
+        tairStringApplyTxnOp(ctx, argv, &txn.ops[i]);
+    }
+
+    return REDISMODULE_OK;
+}
+
+/* Compare the native string in 'key', opened as 'keyname', with 'expected'.
+ * Returns -1 if the key does not exist, 0 if the value differs, 1 if it is
+ * equal. */
+static int stringTypeCompare(RedisModuleCtx *ctx, RedisModuleKey *key, RedisModuleString *keyname,
+                             RedisModuleString *expected) {
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+        return -1;
+    }
+
+    size_t proto_len, expect_len;
+    RedisModuleCallReply *replay = RedisModule_Call(ctx, "GET", "s", keyname);
+    if (RedisModule_CallReplyType(replay) != REDISMODULE_REPLY_STRING) {
+        return 0;
+    }
+
+    const char *proto_ptr = RedisModule_CallReplyStringPtr(replay, &proto_len);
+    const char *expect_ptr = RedisModule_StringPtrLen(expected, &expect_len);
+    if (proto_len != expect_len || memcmp(expect_ptr, proto_ptr, proto_len) != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+/* CAD <key> <value> */
+int StringTypeCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 3) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    int ret = stringTypeCompare(ctx, key, argv[1], argv[2]);
+    if (ret != 1) {
+        RedisModule_ReplyWithLongLong(ctx, ret);
+        return REDISMODULE_OK;
+    }
+
+    RedisModule_DeleteKey(key);
+    RedisModule_Replicate(ctx, "DEL", "s", argv[1]);
+    RedisModule_ReplyWithLongLong(ctx, 1);
+    return REDISMODULE_OK;
+}
+
+/* CAS <Key> <oldvalue> <newvalue> [EX/EXAT/PX/PXAT time] [KEEPTTL] */
+int StringTypeCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    long long milliseconds = 0, expire = 0;
+    RedisModuleString *expire_p = NULL;
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL;
+    if (parseAndGetExFlags(argv, argc, 4, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != expire_p) && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((expire_p && expire <=0)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    int ret = stringTypeCompare(ctx, key, argv[1], argv[2]);
+    if (ret != 1) {
+        RedisModule_ReplyWithLongLong(ctx, ret);
+        return REDISMODULE_OK;
+    }
+
     if (RedisModule_StringSet(key, argv[3]) != REDISMODULE_OK) {
         return REDISMODULE_ERR;
     }
 
     if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
+        milliseconds = tairStringRelativeExpire(ex_flags, expire, RedisModule_Milliseconds());
+        RedisModule_SetExpire(key, milliseconds);
+    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
+        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
+    }
+
+    RedisModule_Replicate(ctx, "SET", "ss", argv[1], argv[3]);
+    if (expire_p) {
+        RedisModule_Replicate(ctx, "PEXPIREAT", "sl", argv[1], (milliseconds + RedisModule_Milliseconds()));
+    }
+
+    RedisModule_ReplyWithLongLong(ctx, 1);
+    return REDISMODULE_OK;
+}
+
+/* Set the native string in 'key', opened as 'keyname', to 'value' and set
+ * its expire ('expire' is NULL without EX/EXAT/PX/PXAT), or keep its TTL with
+ * KEEPTTL. Replicates as SET, and PEXPIREAT if the key has an expire. */
+static void stringTypeSet(RedisModuleCtx *ctx, RedisModuleKey *key, RedisModuleString *keyname,
+                          RedisModuleString *value, int ex_flags, const long long *expire) {
+    long long milliseconds = RedisModule_GetExpire(key);
+
+    RedisModule_StringSet(key, value);
+    if (expire) {
+        milliseconds = tairStringRelativeExpire(ex_flags, *expire, RedisModule_Milliseconds());
+    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
+        milliseconds = REDISMODULE_NO_EXPIRE;
+    }
+    RedisModule_SetExpire(key, milliseconds);
+
+    RedisModule_Replicate(ctx, "SET", "ss", keyname, value);
+    if (milliseconds != REDISMODULE_NO_EXPIRE) {
+        RedisModule_Replicate(ctx, "PEXPIREAT", "sl", keyname, milliseconds + RedisModule_Milliseconds());
+    }
+}
+
+/* MCAS <numkeys> <key> <oldvalue> <newvalue> [<key> <oldvalue> <newvalue> ...] [ATOMIC]
+ *      [EX/EXAT/PX/PXAT time] [KEEPTTL]
+ * A CAS per key on native strings, in order, the options apply to every key.
+ * Replies per key as CAS does: 1 swapped, 0 the value differs, -1 the key
+ * does not exist, or a WRONGTYPE error. Without ATOMIC the keys are swapped
+ * independently. With ATOMIC nothing is written unless every comparison
+ * passes, a key given twice being compared with the earlier newvalue, and a
+ * key of another type fails the whole command. */
+int StringTypeMCas_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    long long numkeys;
+    int i, j, n, start = 2, atomic = 0;
+    if (argc < 2 || RedisModule_StringToLongLong(argv[1], &numkeys) != REDISMODULE_OK || numkeys <= 0 ||
+        numkeys > (argc - start) / 3) {
+        numkeys = 0;
+    }
+    n = (int)numkeys;
+    /* Before the arity check, a keys position request has no client. */
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (i = 0; i < n; i++) {
+            RedisModule_KeyAtPos(ctx, start + 3 * i);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 5) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (!n) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    int opts = start + 3 * n;
+    if (opts < argc && !mstringcasecmp(argv[opts], "atomic")) {
+        atomic = 1;
+        opts++;
+    }
+
+    long long expire = 0;
+    RedisModuleString *expire_p = NULL;
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL;
+    if (parseAndGetExFlags(argv, argc, opts, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK ||
+        (expire_p && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK || expire <= 0))) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    int *results = RedisModule_PoolAlloc(ctx, sizeof(int) * n);
+    if (atomic) {
+        int swap = 1;
+        for (i = 0; i < n; i++) {
+            RedisModuleString **arg = &argv[start + 3 * i];
+            for (j = i - 1; j >= 0 && RedisModule_StringCompare(argv[start + 3 * j], arg[0]); j--)
+                ;
+            if (j >= 0) {
+                results[i] = !RedisModule_StringCompare(argv[start + 3 * j + 2], arg[1]);
+            } else {
+                RedisModuleKey *key = RedisModule_OpenKey(ctx, arg[0], REDISMODULE_READ);
+                int type = RedisModule_KeyType(key);
+                if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+                    RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+                    return REDISMODULE_ERR;
+                }
+                results[i] = stringTypeCompare(ctx, key, arg[0], arg[1]);
+                RedisModule_CloseKey(key);
+            }
+            swap = swap && results[i] == 1;
         }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                milliseconds = 0;
+        if (!swap) {
+            RedisModule_ReplyWithArray(ctx, n);
+            for (i = 0; i < n; i++) {
+                RedisModule_ReplyWithLongLong(ctx, results[i]);
             }
+            return REDISMODULE_OK;
+        }
+    }
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < n; i++) {
+        RedisModuleString **arg = &argv[start + 3 * i];
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, arg[0], REDISMODULE_READ | REDISMODULE_WRITE);
+        int type = RedisModule_KeyType(key);
+
+        if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
         } else {
-            milliseconds = expire;
+            int ret = atomic ? 1 : stringTypeCompare(ctx, key, arg[0], arg[1]);
+            if (ret == 1) {
+                stringTypeSet(ctx, key, arg[0], arg[2], ex_flags, expire_p ? &expire : NULL);
+            }
+            RedisModule_ReplyWithLongLong(ctx, ret);
         }
+        RedisModule_CloseKey(key);
+    }
 
-        RedisModule_SetExpire(key, milliseconds);
-    } else if (!(ex_flags & TAIR_STRING_SET_KEEPTTL)) {
-        RedisModule_SetExpire(key, REDISMODULE_NO_EXPIRE);
+    return REDISMODULE_OK;
+}
+
+/* MCAD <numkeys> <key> <value> [<key> <value> ...] [ATOMIC]
+ * A CAD per key on native strings, in order. Replies per key as CAD does: 1
+ * deleted, 0 the value differs, -1 the key does not exist, or a WRONGTYPE
+ * error. Without ATOMIC the keys are deleted independently, with ATOMIC none
+ * is deleted unless every comparison passes, and a key of another type fails
+ * the whole command. The deleted keys replicate as a single DEL. */
+int StringTypeMCad_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    long long numkeys;
+    int i, j, n, start = 2, atomic = 0;
+    if (argc < 2 || RedisModule_StringToLongLong(argv[1], &numkeys) != REDISMODULE_OK || numkeys <= 0 ||
+        numkeys > (argc - start) / 2) {
+        numkeys = 0;
+    }
+    n = (int)numkeys;
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        for (i = 0; i < n; i++) {
+            RedisModule_KeyAtPos(ctx, start + 2 * i);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (!n) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+    if (start + 2 * n < argc) {
+        if (start + 2 * n + 1 != argc || mstringcasecmp(argv[start + 2 * n], "atomic")) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        atomic = 1;
+    }
+
+    int *results = RedisModule_PoolAlloc(ctx, sizeof(int) * n);
+    if (atomic) {
+        int del = 1;
+        for (i = 0; i < n; i++) {
+            RedisModuleString **arg = &argv[start + 2 * i];
+            for (j = i - 1; j >= 0 && RedisModule_StringCompare(argv[start + 2 * j], arg[0]); j--)
+                ;
+            if (j >= 0) {
+                /* Deleted by the earlier occurrence. */
+                results[i] = -1;
+            } else {
+                RedisModuleKey *key = RedisModule_OpenKey(ctx, arg[0], REDISMODULE_READ);
+                int type = RedisModule_KeyType(key);
+                if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+                    RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+                    return REDISMODULE_ERR;
+                }
+                results[i] = stringTypeCompare(ctx, key, arg[0], arg[1]);
+                RedisModule_CloseKey(key);
+            }
+            del = del && results[i] == 1;
+        }
+        if (!del) {
+            RedisModule_ReplyWithArray(ctx, n);
+            for (i = 0; i < n; i++) {
+                RedisModule_ReplyWithLongLong(ctx, results[i]);
+            }
+            return REDISMODULE_OK;
+        }
+    }
+
+    RedisModuleString **deleted = RedisModule_PoolAlloc(ctx, sizeof(RedisModuleString *) * n);
+    size_t ndeleted = 0;
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < n; i++) {
+        RedisModuleString **arg = &argv[start + 2 * i];
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, arg[0], REDISMODULE_READ | REDISMODULE_WRITE);
+        int type = RedisModule_KeyType(key);
+
+        if (REDISMODULE_KEYTYPE_EMPTY != type && type != REDISMODULE_KEYTYPE_STRING) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        } else {
+            int ret = stringTypeCompare(ctx, key, arg[0], arg[1]);
+            if (ret == 1) {
+                RedisModule_DeleteKey(key);
+                deleted[ndeleted++] = arg[0];
+            }
+            RedisModule_ReplyWithLongLong(ctx, ret);
+        }
+        RedisModule_CloseKey(key);
+    }
+    if (ndeleted) {
+        RedisModule_Replicate(ctx, "DEL", "v", deleted, ndeleted);
+    }
+
+    return REDISMODULE_OK;
+}
+// 文档中，没有写，不看。
+/* EXPREPEND <key> <value> [NX|XX] [VER/ABS version] */
+int TairStringTypeExPrepend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 3) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleString *version_p = NULL;
+    long long version = 0;
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER;
+    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, NULL, &version_p, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != version_p) && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if (version < 0) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    size_t originalLength;
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
+    RedisModuleString *newvalue;
+    int type = RedisModule_KeyType(key);
+
+    TairStringObj *tair_string_obj = NULL;
+
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        /* not exist: result = argv[2] */
+        if (ex_flags & TAIR_STRING_SET_XX) {
+            RedisModule_ReplyWithNull(ctx);
+            return REDISMODULE_ERR;
+        }
+        tair_string_obj = createTairStringTypeObject();
+        tair_string_obj->value = argv[2];
+        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
+        RedisModule_RetainString(ctx, argv[2]);
+    } else {
+        /* exist: result = argv[2] + original */
+        /* Statements like "tair_string_obj->value = argv[2];
+        Append(tair_string_obj->value, original);" would lead to a mistake when
+        replicating the command from master to slave, so it's necessary to
+        create a copy of argv[2] and use the copy to get the command executed.
+      */
+
+        if (ex_flags & TAIR_STRING_SET_NX) {
+            RedisModule_ReplyWithNull(ctx);
+            return REDISMODULE_ERR;
+        }
+
+        if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+        tair_string_obj = RedisModule_ModuleTypeGetValue(key);
+
+        if (!tairStringVersionMatches(ex_flags, version, tair_string_obj->version)) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
+            return REDISMODULE_ERR;
+        }
+
+        /* Convert RedisModuleString to cstring to use StringAppendBuffer() */
+        const char *c_string_original = RedisModule_StringPtrLen(tair_string_obj->value, &originalLength);
+        newvalue = RedisModule_CreateStringFromString(ctx, argv[2]);
+
+        if (RedisModule_StringAppendBuffer(ctx, newvalue, c_string_original, originalLength) == REDISMODULE_ERR) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_APPENDBUFFER);
+            return REDISMODULE_ERR;
+        }
+
+        if (tair_string_obj->value) {
+            RedisModule_FreeString(ctx, tair_string_obj->value);
+        }
+
+        tair_string_obj->value = newvalue;
+        RedisModule_RetainString(NULL, newvalue);
+    }
+
+    tair_string_obj->version = tairStringNextVersion(ex_flags, version, tair_string_obj->version);
+
+    RedisModule_ReplicateVerbatim(ctx);
+    RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    return REDISMODULE_OK;
+}
+
+// 文档中，没有写，不看。
+/* EXAPPEND <key> <value> [NX|XX] [VER/ABS version] */
+int TairStringTypeExAppend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+    if (argc < 3) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleString *version_p = NULL;
+    long long version = 0;
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER;
+    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, NULL, &version_p, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if ((NULL != version_p) && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK)) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    if (version < 0) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+
+    size_t appendLength;
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+
+    TairStringObj *tair_string_obj = NULL;
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        /* not exist: result = argv[2] */
+        if (ex_flags & TAIR_STRING_SET_XX) {
+            RedisModule_ReplyWithNull(ctx);
+            return REDISMODULE_ERR;
+        }
+
+        tair_string_obj = createTairStringTypeObject();
+        tair_string_obj->value = argv[2];
+        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
+        RedisModule_RetainString(NULL, argv[2]);
+
+    } else {
+        /* exist: result = original + argv[2] */
+        if (ex_flags & TAIR_STRING_SET_NX) {
+            RedisModule_ReplyWithNull(ctx);
+            return REDISMODULE_ERR;
+        }
+        if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+        tair_string_obj = RedisModule_ModuleTypeGetValue(key);
+
+        if (!tairStringVersionMatches(ex_flags, version, tair_string_obj->version)) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
+            return REDISMODULE_ERR;
+        }
+
+        /* Convert RedisModuleString to cstring to use StringAppendBuffer() */
+        const char *c_string_argv = RedisModule_StringPtrLen(argv[2], &appendLength);
+
+        if (RedisModule_StringAppendBuffer(ctx, tair_string_obj->value, c_string_argv, appendLength)
+            == REDISMODULE_ERR) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_APPENDBUFFER);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    tair_string_obj->version = tairStringNextVersion(ex_flags, version, tair_string_obj->version);
+
+    RedisModule_ReplicateVerbatim(ctx);
+    RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    return REDISMODULE_OK;
+}
+
+/* EXGETRANGE <key> <start> <end>
+ * GETRANGE on an exstrtype: replies [substring, version], the version being
+ * the one to pass to EXSETRANGE VER. start and end are inclusive, negative
+ * ones count from the end. */
+int TairStringTypeExGetRange_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    long long start, end;
+    if (RedisModule_StringToLongLong(argv[2], &start) != REDISMODULE_OK
+        || RedisModule_StringToLongLong(argv[3], &end) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    }
+
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithNull(ctx);
+        return REDISMODULE_OK;
     }
 
-    RedisModule_Replicate(ctx, "SET", "ss", argv[1], argv[3]);
-    if (expire_p) {
-        RedisModule_Replicate(ctx, "PEXPIREAT", "sl", argv[1], (milliseconds + RedisModule_Milliseconds()));
-    }
+    TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
+    size_t len;
+    const char *s = RedisModule_StringPtrLen(o->value, &len);
 
-    RedisModule_ReplyWithLongLong(ctx, 1);
+    if (start < 0) start += len;
+    if (end < 0) end += len;
+    if (start < 0) start = 0;
+    if (end < 0) end = 0;
+    if ((size_t)end >= len) end = (long long)len - 1;
+
+    RedisModule_ReplyWithArray(ctx, 2);
+    if (len == 0 || start > end) {
+        RedisModule_ReplyWithStringBuffer(ctx, "", 0);
+    } else {
+        RedisModule_ReplyWithStringBuffer(ctx, s + start, end - start + 1);
+    }
+    RedisModule_ReplyWithLongLong(ctx, o->version);
     return REDISMODULE_OK;
 }
-// 文档中，没有写，不看。
-/* EXPREPEND <key> <value> [NX|XX] [VER/ABS version] */
-int TairStringTypeExPrepend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+
+/* EXSETRANGE <key> <offset> <value> [NX|XX] [VER/ABS version]
+ * SETRANGE on an exstrtype: overwrite the value from offset, padding it with
+ * zero bytes when it is shorter, with the NX/XX and VER/ABS rules of EXAPPEND
+ * and the TTL kept. Replies the new version, or 0 when an empty value leaves
+ * a missing key missing. */
+int TairStringTypeExSetRange_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
-    if (argc < 3) {
+    if (argc < 4) {
         return RedisModule_WrongArity(ctx);
     }
 
     RedisModuleString *version_p = NULL;
-    long long version = 0;
+    long long version = 0, offset;
     int ex_flags = TAIR_STRING_SET_NO_FLAGS;
     unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER;
-    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, NULL, &version_p, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+    if (parseAndGetExFlags(argv, argc, 4, &ex_flags, NULL, &version_p, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
         RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
         return REDISMODULE_ERR;
     }
@@ -1090,154 +2292,254 @@ int TairStringTypeExPrepend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString
         return REDISMODULE_ERR;
     }
 
-    size_t originalLength;
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
-    RedisModuleString *newvalue;
+    if (RedisModule_StringToLongLong(argv[2], &offset) != REDISMODULE_OK) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_INT);
+        return REDISMODULE_ERR;
+    }
+
+    size_t patch_len;
+    const char *patch = RedisModule_StringPtrLen(argv[3], &patch_len);
+    if (offset < 0) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_OFFSET);
+        return REDISMODULE_ERR;
+    }
+    if ((unsigned long long)offset + patch_len > TAIRSTRING_MAX_STRING_LEN) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_MAXSIZE);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
     int type = RedisModule_KeyType(key);
 
     TairStringObj *tair_string_obj = NULL;
-
     if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        /* not exist: result = argv[2] */
         if (ex_flags & TAIR_STRING_SET_XX) {
             RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
-        tair_string_obj = createTairStringTypeObject();
-        tair_string_obj->value = argv[2];
-        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
-        RedisModule_RetainString(ctx, argv[2]);
+        /* As SETRANGE, an empty value does not create the key. */
+        if (patch_len == 0) {
+            RedisModule_ReplyWithLongLong(ctx, 0);
+            return REDISMODULE_OK;
+        }
     } else {
-        /* exist: result = argv[2] + original */
-        /* Statements like "tair_string_obj->value = argv[2];
-        Append(tair_string_obj->value, original);" would lead to a mistake when
-        replicating the command from master to slave, so it's necessary to
-        create a copy of argv[2] and use the copy to get the command executed.
-      */
-
         if (ex_flags & TAIR_STRING_SET_NX) {
             RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
-
         if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
             RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
             return REDISMODULE_ERR;
         }
         tair_string_obj = RedisModule_ModuleTypeGetValue(key);
 
-        if (ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && version != tair_string_obj->version) {
+        if (!tairStringVersionMatches(ex_flags, version, tair_string_obj->version)) {
             RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
             return REDISMODULE_ERR;
         }
+    }
 
-        /* Convert RedisModuleString to cstring to use StringAppendBuffer() */
-        const char *c_string_original = RedisModule_StringPtrLen(tair_string_obj->value, &originalLength);
-        newvalue = RedisModule_CreateStringFromString(ctx, argv[2]);
+    /* The value may still be shared with the arguments of an earlier command
+     * of a MULTI, so the new value is built aside instead of in place: the
+     * bytes before offset, the zero padding, the patch and the bytes after
+     * it are appended to a string of our own, each copied once. */
+    static const char zeros[4096];
+    size_t old_len = 0, head_len, pad, chunk;
+    const char *old = tair_string_obj ? RedisModule_StringPtrLen(tair_string_obj->value, &old_len) : "";
+    head_len = (size_t)offset < old_len ? (size_t)offset : old_len;
+    RedisModuleString *newvalue = RedisModule_CreateString(NULL, old, head_len);
+    for (pad = (size_t)offset - head_len; pad > 0; pad -= chunk) {
+        chunk = pad < sizeof(zeros) ? pad : sizeof(zeros);
+        RedisModule_StringAppendBuffer(ctx, newvalue, zeros, chunk);
+    }
+    RedisModule_StringAppendBuffer(ctx, newvalue, patch, patch_len);
+    if ((size_t)offset + patch_len < old_len) {
+        RedisModule_StringAppendBuffer(ctx, newvalue, old + offset + patch_len, old_len - offset - patch_len);
+    }
 
-        if (RedisModule_StringAppendBuffer(ctx, newvalue, c_string_original, originalLength) == REDISMODULE_ERR) {
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_APPENDBUFFER);
+    if (tair_string_obj == NULL) {
+        tair_string_obj = createTairStringTypeObject();
+        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
+    } else {
+        RedisModule_FreeString(NULL, tair_string_obj->value);
+    }
+    tair_string_obj->value = newvalue;
+    tair_string_obj->version = tairStringNextVersion(ex_flags, version, tair_string_obj->version);
+
+    RedisModule_ReplicateVerbatim(ctx);
+    RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    return REDISMODULE_OK;
+}
+
+/* ============================ Chunked uploads =============================
+ * A value too big for one EXSET is staged in an upload key, an "exupltype"
+ * session that EXUPBEGIN creates empty with a deadline and EXUPAPPEND grows
+ * one chunk at a time, so other clients run between the chunks. EXUPCOMMIT
+ * then moves the staged value into the target key with the preconditions of
+ * EXSET, without copying it. The session has its own type so that only
+ * EXUPBEGIN keys are appended to in place: the staged string is created by
+ * the module and never shared with a command argument, and an exstrtype
+ * value cannot change without its version. Being a key, the staging memory
+ * is counted in used_memory and MEMORY USAGE, refused by maxmemory (the
+ * commands are deny-oom), persisted and replicated; an abandoned upload
+ * expires at its deadline, or is dropped with DEL. */
+
+#define TAIRSTRING_UPLOAD_DEFAULT_TTL 3600
+
+/* EXUPBEGIN <upload> [EX/EXAT/PX/PXAT time] */
+int TairStringTypeExUpBegin_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 2 && argc != 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleString *expire_p = NULL;
+    long long expire = TAIRSTRING_UPLOAD_DEFAULT_TTL, milliseconds;
+    int ex_flags = TAIR_STRING_SET_EX;
+    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE;
+    if (argc == 4) {
+        ex_flags = TAIR_STRING_SET_NO_FLAGS;
+        if (parseAndGetExFlags(argv, argc, 2, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK
+            || RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK || expire <= 0) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
             return REDISMODULE_ERR;
         }
+    }
 
-        if (tair_string_obj->value) {
-            RedisModule_FreeString(ctx, tair_string_obj->value);
-        }
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithNull(ctx);
+        return REDISMODULE_ERR;
+    }
 
-        tair_string_obj->value = newvalue;
-        RedisModule_RetainString(NULL, newvalue);
+    RedisModule_ModuleTypeSetValue(key, TairStringUploadType, RedisModule_CreateString(NULL, "", 0));
+    milliseconds = tairStringRelativeExpire(ex_flags, expire, RedisModule_Milliseconds());
+    RedisModule_SetExpire(key, milliseconds);
+
+    RedisModule_Replicate(ctx, "EXUPBEGIN", "scl", argv[1], "PXAT", milliseconds + RedisModule_Milliseconds());
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    return REDISMODULE_OK;
+}
+
+/* EXUPAPPEND <upload> <chunk>
+ * Replies the number of bytes staged, so that an interrupted upload can
+ * resume. */
+int TairStringTypeExUpAppend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 3) {
+        return RedisModule_WrongArity(ctx);
     }
 
-    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
-        tair_string_obj->version = version;
-    } else {
-        tair_string_obj->version++;
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_UPLOAD);
+        return REDISMODULE_ERR;
+    }
+    if (RedisModule_ModuleTypeGetType(key) != TairStringUploadType) {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    RedisModuleString *staged = RedisModule_ModuleTypeGetValue(key);
+    size_t len;
+    const char *chunk = RedisModule_StringPtrLen(argv[2], &len);
+    if (RedisModule_StringAppendBuffer(ctx, staged, chunk, len) == REDISMODULE_ERR) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_APPENDBUFFER);
+        return REDISMODULE_ERR;
     }
+    RedisModule_StringPtrLen(staged, &len);
 
     RedisModule_ReplicateVerbatim(ctx);
-    RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    RedisModule_ReplyWithLongLong(ctx, (long long)len);
     return REDISMODULE_OK;
 }
 
-// 文档中，没有写，不看。
-/* EXAPPEND <key> <value> [NX|XX] [VER/ABS version] */
-int TairStringTypeExAppend_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+/* EXUPCOMMIT <upload> <key> [EX/EXAT/PX/PXAT time] [NX/XX] [VER/ABS version] [FLAGS flags] [KEEPTTL]
+ * Publish the staged value as EXSET would, and delete the upload. When NX/XX
+ * or VER fails the reply is that of EXSET and the upload is kept. Replies the
+ * new version. */
+int TairStringTypeExUpCommit_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
+
     if (argc < 3) {
         return RedisModule_WrongArity(ctx);
     }
 
-    RedisModuleString *version_p = NULL;
-    long long version = 0;
+    long long milliseconds = 0, expire = 0, version = 0, flags = 0;
+    RedisModuleString *expire_p = NULL, *version_p = NULL, *flags_p = NULL;
     int ex_flags = TAIR_STRING_SET_NO_FLAGS;
-    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER;
-    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, NULL, &version_p, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK) {
+    unsigned int allow_flags = TAIR_STRING_SET_NX | TAIR_STRING_SET_XX | TAIR_STRING_SET_EX | TAIR_STRING_SET_PX |
+                               TAIR_STRING_SET_ABS_EXPIRE | TAIR_STRING_SET_KEEPTTL | TAIR_STRING_SET_WITH_VER |
+                               TAIR_STRING_SET_WITH_ABS_VER | TAIR_STRING_SET_WITH_FLAGS;
+    if (parseAndGetExFlags(argv, argc, 3, &ex_flags, &expire_p, &version_p, &flags_p, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK
+        || (expire_p && (RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK || expire <= 0))
+        || (version_p && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK || version < 0))
+        || (flags_p && (RedisModule_StringToLongLong(flags_p, &flags) != REDISMODULE_OK || flags < 0 || flags > UINT_MAX))
+        || RedisModule_StringCompare(argv[1], argv[2]) == 0) {
         RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
         return REDISMODULE_ERR;
     }
 
-    if ((NULL != version_p) && (RedisModule_StringToLongLong(version_p, &version) != REDISMODULE_OK)) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+    RedisModuleKey *upload = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(upload) == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_NO_UPLOAD);
         return REDISMODULE_ERR;
     }
-
-    if (version < 0) {
-        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+    if (RedisModule_ModuleTypeGetType(upload) != TairStringUploadType) {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
         return REDISMODULE_ERR;
     }
 
-    size_t appendLength;
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_WRITE);
-    int type = RedisModule_KeyType(key);
-
-    TairStringObj *tair_string_obj = NULL;
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        /* not exist: result = argv[2] */
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[2], REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
         if (ex_flags & TAIR_STRING_SET_XX) {
             RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
-
-        tair_string_obj = createTairStringTypeObject();
-        tair_string_obj->value = argv[2];
-        RedisModule_ModuleTypeSetValue(key, TairStringType, tair_string_obj);
-        RedisModule_RetainString(NULL, argv[2]);
-
     } else {
-        /* exist: result = original + argv[2] */
-        if (ex_flags & TAIR_STRING_SET_NX) {
-            RedisModule_ReplyWithNull(ctx);
-            return REDISMODULE_ERR;
-        }
         if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
             RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
             return REDISMODULE_ERR;
         }
-        tair_string_obj = RedisModule_ModuleTypeGetValue(key);
-
-        if (ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && version != tair_string_obj->version) {
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
+        if (ex_flags & TAIR_STRING_SET_NX) {
+            RedisModule_ReplyWithNull(ctx);
             return REDISMODULE_ERR;
         }
-
-        /* Convert RedisModuleString to cstring to use StringAppendBuffer() */
-        const char *c_string_argv = RedisModule_StringPtrLen(argv[2], &appendLength);
-
-        if (RedisModule_StringAppendBuffer(ctx, tair_string_obj->value, c_string_argv, appendLength)
-            == REDISMODULE_ERR) {
-            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_APPENDBUFFER);
+        TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
+        if (!tairStringVersionMatches(ex_flags, version, o->version)) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_VERSION);
             return REDISMODULE_ERR;
         }
     }
 
-    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
-        tair_string_obj->version = version;
-    } else {
-        tair_string_obj->version++;
+    /* The target retains the staged value before the upload releases it. */
+    RedisModuleString *staged = RedisModule_ModuleTypeGetValue(upload);
+    TairStringObj *o = tairStringStore(key, staged, ex_flags, version, flags, expire_p ? &expire : NULL, &milliseconds);
+    RedisModule_DeleteKey(upload);
+
+    /* Rewrite relative value to absolute value. */
+    size_t vlen = 4;
+    RedisModuleString *v[9];
+    v[0] = argv[1];
+    v[1] = argv[2];
+    v[2] = RedisModule_CreateString(ctx, "ABS", 3);
+    v[3] = RedisModule_CreateStringFromLongLong(ctx, o->version);
+    if (expire_p) {
+        v[vlen++] = RedisModule_CreateString(ctx, "PXAT", 4);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, milliseconds + RedisModule_Milliseconds());
+    } else if (ex_flags & TAIR_STRING_SET_KEEPTTL) {
+        v[vlen++] = RedisModule_CreateString(ctx, "KEEPTTL", 7);
+    }
+    if (flags_p) {
+        v[vlen++] = RedisModule_CreateString(ctx, "FLAGS", 5);
+        v[vlen++] = RedisModule_CreateStringFromLongLong(ctx, (long long)o->flags);
     }
+    RedisModule_Replicate(ctx, "EXUPCOMMIT", "v", v, vlen);
 
-    RedisModule_ReplicateVerbatim(ctx);
-    RedisModule_ReplyWithLongLong(ctx, tair_string_obj->version);
+    RedisModule_ReplyWithLongLong(ctx, o->version);
     return REDISMODULE_OK;
 }
 
@@ -1280,18 +2582,7 @@ int TairStringTypeExGAE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
     }
 
     if (expire_p) {
-        if (ex_flags & TAIR_STRING_SET_EX) {
-            expire *= 1000;
-        }
-        if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
-            milliseconds = expire - RedisModule_Milliseconds();
-            if (milliseconds < 0) {
-                milliseconds = 0;
-            }
-        } else {
-            milliseconds = expire;
-        }
-
+        milliseconds = tairStringRelativeExpire(ex_flags, expire, RedisModule_Milliseconds());
         RedisModule_SetExpire(key, milliseconds);
     }
 
@@ -1306,6 +2597,134 @@ int TairStringTypeExGAE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **ar
     return REDISMODULE_OK;
 }
 
+/* EXMGAE <EX time | EXAT time | PX time | PXAT time> <key> <version> [<key> <version> ...]
+ * Renew many leases at once: set the expire of every key whose version is
+ * the given one, like EXGAE the version is not changed. Replies per key 1 if
+ * renewed, 0 if the version does not match (the lease is lost), -1 if the key
+ * does not exist, or a WRONGTYPE error. The renewed keys replicate as a
+ * single EXMGAE with the absolute expire. */
+int TairStringTypeExMGAE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 5 || argc % 2 == 0) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleString *expire_p = NULL;
+    long long expire = 0, milliseconds, now = RedisModule_Milliseconds();
+    int ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    unsigned int allow_flags = TAIR_STRING_SET_EX | TAIR_STRING_SET_PX | TAIR_STRING_SET_ABS_EXPIRE;
+    if (parseAndGetExFlags(argv, 3, 1, &ex_flags, &expire_p, NULL, NULL, NULL, NULL, NULL, allow_flags) != REDISMODULE_OK ||
+        !expire_p || RedisModule_StringToLongLong(expire_p, &expire) != REDISMODULE_OK || expire <= 0) {
+        RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+        return REDISMODULE_ERR;
+    }
+    milliseconds = tairStringRelativeExpire(ex_flags, expire, now);
+
+    int i, n = (argc - 3) / 2;
+    long long *versions = RedisModule_PoolAlloc(ctx, sizeof(long long) * n);
+    for (i = 0; i < n; i++) {
+        if (RedisModule_StringToLongLong(argv[4 + 2 * i], &versions[i]) != REDISMODULE_OK) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    /* PXAT time, then key version per renewed key. */
+    RedisModuleString **v = RedisModule_PoolAlloc(ctx, sizeof(RedisModuleString *) * (2 + 2 * n));
+    size_t vlen = 2;
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < n; i++) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[3 + 2 * i], REDISMODULE_READ | REDISMODULE_WRITE);
+        int type = RedisModule_KeyType(key);
+
+        if (type == REDISMODULE_KEYTYPE_EMPTY) {
+            RedisModule_ReplyWithLongLong(ctx, -1);
+        } else if (RedisModule_ModuleTypeGetType(key) != TairStringType) {
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        } else if (((TairStringObj *)RedisModule_ModuleTypeGetValue(key))->version != versions[i]) {
+            RedisModule_ReplyWithLongLong(ctx, 0);
+        } else {
+            RedisModule_SetExpire(key, milliseconds);
+            v[vlen++] = argv[3 + 2 * i];
+            v[vlen++] = argv[4 + 2 * i];
+            RedisModule_ReplyWithLongLong(ctx, 1);
+        }
+        RedisModule_CloseKey(key);
+    }
+    if (vlen > 2) {
+        v[0] = RedisModule_CreateString(ctx, "PXAT", 4);
+        v[1] = RedisModule_CreateStringFromLongLong(ctx, milliseconds + now);
+        RedisModule_Replicate(ctx, "EXMGAE", "v", v, vlen);
+    }
+
+    return REDISMODULE_OK;
+}
+
+/* EXGETEX <key> [EX time | PX time] [BELOW threshold]
+ * EXGET with the flags and the remaining TTL: replies [value, version, flags,
+ * pttl], pttl being -1 without expire. EX/PX slide the expire to 'time' from
+ * now, with BELOW (same unit, not above 'time') only when the remaining TTL
+ * is under 'threshold', so that hot reads of a session do not rewrite its TTL
+ * every time. A refresh replicates as PEXPIREAT, a plain read replicates
+ * nothing. */
+int TairStringTypeExGetEx_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 2 && argc != 4 && argc != 6) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    long long window = 0, below = 0, n;
+    int j, ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    for (j = 2; j < argc; j += 2) {
+        if (RedisModule_StringToLongLong(argv[j + 1], &n) != REDISMODULE_OK || n <= 0) {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+        if (j == 2 && !mstringcasecmp(argv[j], "ex")) {
+            ex_flags |= TAIR_STRING_SET_EX;
+            window = n;
+        } else if (j == 2 && !mstringcasecmp(argv[j], "px")) {
+            ex_flags |= TAIR_STRING_SET_PX;
+            window = n;
+        } else if (j == 4 && !mstringcasecmp(argv[j], "below") && n <= window) {
+            below = tairStringRelativeExpire(ex_flags, n, 0);
+        } else {
+            RedisModule_ReplyWithError(ctx, TAIRSTRING_ERRORMSG_SYNTAX);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != TairStringType) {
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    }
+
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_ReplyWithNull(ctx);
+        return REDISMODULE_OK;
+    }
+
+    long long ttl = RedisModule_GetExpire(key);
+    if (window && (!below || (ttl != REDISMODULE_NO_EXPIRE && ttl < below))) {
+        ttl = tairStringRelativeExpire(ex_flags, window, 0);
+        RedisModule_SetExpire(key, ttl);
+        RedisModule_Replicate(ctx, "PEXPIREAT", "sl", argv[1], RedisModule_Milliseconds() + ttl);
+    }
+
+    TairStringObj *o = RedisModule_ModuleTypeGetValue(key);
+
+    RedisModule_ReplyWithArray(ctx, 4);
+    RedisModule_ReplyWithString(ctx, o->value);
+    RedisModule_ReplyWithLongLong(ctx, o->version);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->flags);
+    RedisModule_ReplyWithLongLong(ctx, ttl);
+    return REDISMODULE_OK;
+}
+
 /* ========================== "exstrtype" type methods =======================*/
 // 估计需要定义一些方法，供redis module 调用。
 void *TairStringTypeRdbLoad(RedisModuleIO *rdb, int encver) {
@@ -1358,17 +2777,55 @@ void TairStringTypeDigest(RedisModuleDigest *md, void *value) {
     RedisModule_DigestAddStringBuffer(md, (unsigned char *)str, len);
     RedisModule_DigestEndSequence(md);
 }
+
+/* ========================== "exupltype" type methods =======================*/
+void *TairStringUploadTypeRdbLoad(RedisModuleIO *rdb, int encver) {
+    if (encver != TAIRSTRING_UPLOAD_ENCVER_VER_1) {
+        return NULL;
+    }
+    return RedisModule_LoadString(rdb);
+}
+
+void TairStringUploadTypeRdbSave(RedisModuleIO *rdb, void *value) {
+    assert(value != NULL);
+    RedisModule_SaveString(rdb, value);
+}
+
+void TairStringUploadTypeAofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value) {
+    assert(value != NULL);
+    /* The deadline follows as the PEXPIREAT of the key. */
+    RedisModule_EmitAOF(aof, "EXUPBEGIN", "s", key);
+    RedisModule_EmitAOF(aof, "EXUPAPPEND", "ss", key, value);
+}
+
+size_t TairStringUploadTypeMemUsage(const void *value) {
+    size_t len;
+    assert(value != NULL);
+    RedisModule_StringPtrLen(value, &len);
+    return len;
+}
+
+void TairStringUploadTypeFree(void *value) { RedisModule_FreeString(NULL, value); }
+
+void TairStringUploadTypeDigest(RedisModuleDigest *md, void *value) {
+    size_t len;
+    assert(value != NULL);
+    const char *str = RedisModule_StringPtrLen(value, &len);
+    RedisModule_DigestAddStringBuffer(md, (unsigned char *)str, len);
+    RedisModule_DigestEndSequence(md);
+}
 /*
 
 
 */
 int Module_CreateCommands(RedisModuleCtx *ctx) {
-#define CREATE_CMD(name, tgt, attr)                                                       \
-    do {                                                                                  \
-        if (RedisModule_CreateCommand(ctx, name, tgt, attr, 1, 1, 1) != REDISMODULE_OK) { \
-            return REDISMODULE_ERR;                                                       \
-        }                                                                                 \
+#define CREATE_CMD_KEYS(name, tgt, attr, firstkey, lastkey, step)                                         \
+    do {                                                                                                  \
+        if (RedisModule_CreateCommand(ctx, name, tgt, attr, firstkey, lastkey, step) != REDISMODULE_OK) { \
+            return REDISMODULE_ERR;                                                                       \
+        }                                                                                                 \
     } while (0);
+#define CREATE_CMD(name, tgt, attr) CREATE_CMD_KEYS(name, tgt, attr, 1, 1, 1)
 /*
 CREATE_CMD 是一个宏，用于简化创建命令的代码。
 name 是命令的名称。
@@ -1380,18 +2837,36 @@ attr 是命令的属性，例如 "write deny-oom" 表示这是一个写命令，
 #define CREATE_ROCMD(name, tgt) CREATE_CMD(name, tgt, "readonly fast")
     // 区分读写命令。
     CREATE_WRCMD("exset", TairStringTypeSet_RedisCommand)
+    CREATE_CMD_KEYS("exmset", TairStringTypeMSet_RedisCommand, "write deny-oom getkeys-api", 1, -1, 1)
     CREATE_ROCMD("exget", TairStringTypeGet_RedisCommand)
+    /* The key positions depend on a trailing WITHFLAGS, hence getkeys-api. */
+    CREATE_CMD_KEYS("exmget", TairStringTypeMGet_RedisCommand, "readonly fast getkeys-api", 1, -1, 1)
+    CREATE_ROCMD("exgetver", TairStringTypeGetVer_RedisCommand)
+    CREATE_CMD_KEYS("exmgetver", TairStringTypeMGetVer_RedisCommand, "readonly fast getkeys-api", 1, -1, 1)
     CREATE_WRCMD("exincrby", TairStringTypeIncrBy_RedisCommand)
+    CREATE_CMD_KEYS("exmincrby", TairStringTypeMIncrBy_RedisCommand, "write deny-oom getkeys-api", 1, -1, 1)
     CREATE_WRCMD("exincrbyfloat", TairStringTypeIncrByFloat_RedisCommand)
     CREATE_WRCMD("exsetver", TairStringTypeExSetVer_RedisCommand)
     CREATE_WRCMD("excas", TairStringTypeExCas_RedisCommand)
     CREATE_WRCMD("excad", TairStringTypeExCad_RedisCommand)
+    CREATE_CMD_KEYS("exmcad", TairStringTypeExMCad_RedisCommand, "write deny-oom", 1, -1, 2)
+    CREATE_CMD_KEYS("extxn", TairStringTypeTxn_RedisCommand, "write deny-oom getkeys-api", 1, -1, 1)
     CREATE_WRCMD("exprepend", TairStringTypeExPrepend_RedisCommand)
     CREATE_WRCMD("exappend", TairStringTypeExAppend_RedisCommand)
+    CREATE_ROCMD("exgetrange", TairStringTypeExGetRange_RedisCommand)
+    CREATE_WRCMD("exsetrange", TairStringTypeExSetRange_RedisCommand)
+    CREATE_CMD_KEYS("exupbegin", TairStringTypeExUpBegin_RedisCommand, "write deny-oom", 1, 1, 1)
+    CREATE_CMD_KEYS("exupappend", TairStringTypeExUpAppend_RedisCommand, "write deny-oom", 1, 1, 1)
+    CREATE_CMD_KEYS("exupcommit", TairStringTypeExUpCommit_RedisCommand, "write deny-oom", 1, 2, 1)
     CREATE_WRCMD("exgae", TairStringTypeExGAE_RedisCommand)
+    CREATE_CMD_KEYS("exmgae", TairStringTypeExMGAE_RedisCommand, "write deny-oom", 3, -1, 2)
+    CREATE_CMD("exgetex", TairStringTypeExGetEx_RedisCommand, "write fast")
     /* CAS/CAD cmds for redis string type. */
     CREATE_WRCMD("cas", StringTypeCas_RedisCommand)
     CREATE_WRCMD("cad", StringTypeCad_RedisCommand)
+    /* The key positions depend on numkeys, hence getkeys-api. */
+    CREATE_CMD_KEYS("mcas", StringTypeMCas_RedisCommand, "write deny-oom getkeys-api", 2, -1, 1)
+    CREATE_CMD_KEYS("mcad", StringTypeMCad_RedisCommand, "write deny-oom getkeys-api", 2, -1, 1)
 
     return REDISMODULE_OK;
 }
@@ -1435,6 +2910,17 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
     if (TairStringType == NULL) {
         return REDISMODULE_ERR;
     }
+    RedisModuleTypeMethods upload_tm = {.version = REDISMODULE_TYPE_METHOD_VERSION,
+                                        .rdb_load = TairStringUploadTypeRdbLoad,
+                                        .rdb_save = TairStringUploadTypeRdbSave,
+                                        .aof_rewrite = TairStringUploadTypeAofRewrite,
+                                        .mem_usage = TairStringUploadTypeMemUsage,
+                                        .free = TairStringUploadTypeFree,
+                                        .digest = TairStringUploadTypeDigest};
+    TairStringUploadType = RedisModule_CreateDataType(ctx, "exupltype", TAIRSTRING_UPLOAD_ENCVER_VER_1, &upload_tm);
+    if (TairStringUploadType == NULL) {
+        return REDISMODULE_ERR;
+    }
     /*
     Module_CreateCommands 函数用于创建模块的自定义命令。
     如果创建命令失败，返回 REDISMODULE_ERR。
@@ -17,6 +17,7 @@
 #pragma once
 
 #define TAIRSTRING_STATUSMSG_VERSION "CAS_FAILED"
+#define TAIRSTRING_STATUSMSG_NOT_MODIFIED "NOT_MODIFIED"
 #define TAIRSTRING_ERRORMSG_SYNTAX "ERR syntax error"
 #define TAIRSTRING_ERRORMSG_VERSION "ERR update version is stale"
 #define TAIRSTRING_ERRORMSG_NO_INT "ERR value is not an integer"
@@ -26,3 +27,10 @@
 #define TAIRSTRING_ERRORMSG_VER_INT "ERR version should be integer"
 #define TAIRSTRING_ERRORMSG_EINVAL "ERR command non existing or wrong arity or wrong format specifier"
 #define TAIRSTRING_ERRORMSG_APPENDBUFFER "ERR append buffer failed"
+#define TAIRSTRING_ERRORMSG_OFFSET "ERR offset is out of range"
+#define TAIRSTRING_ERRORMSG_MAXSIZE "ERR string exceeds maximum allowed size (512MB)"
+
+/* The largest value a command may build, the default proto-max-bulk-len of
+ * the server: a longer one could not be replicated or loaded back. */
+#define TAIRSTRING_MAX_STRING_LEN (512ULL * 1024 * 1024)
+#define TAIRSTRING_ERRORMSG_NO_UPLOAD "ERR no such upload session"
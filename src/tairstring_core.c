@@ -0,0 +1,254 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tairstring_core.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+#include "util.h"
+
+typedef struct RedisModuleString RedisModuleString;
+
+// 转成long double类型的。
+int mstring2ld(RedisModuleString *val, long double *r_val) {
+    if (!val) return REDISMODULE_ERR;
+
+    size_t t_len;
+    const char *t_ptr = RedisModule_StringPtrLen(val, &t_len);
+    if (m_string2ld(t_ptr, t_len, r_val) == 0) {
+        return REDISMODULE_ERR;
+    }
+
+    return REDISMODULE_OK;
+}
+
+int mstringcasecmp(const RedisModuleString *rs1, const char *s2) {
+    size_t n1 = strlen(s2);
+    size_t n2;
+    const char *s1 = RedisModule_StringPtrLen(rs1, &n2);
+    if (n1 != n2) {
+        return -1;
+    }
+    return strncasecmp(s1, s2, n1);
+}
+
+/* Parse the command **argv and get those arguments. Return ex_flags. If parsing
+ * get failed, It would reply with syntax error. The first appearance would be
+ * accepted if there are multiple appearance of a same group, For example: "EX
+ * 3 PX 4000 EXAT 127", the "EX 3" would be accepted and the other two would be
+ * ignored.
+ * */
+/*
+1. 这个函数 parseAndGetExFlags 是一个函数，用于解析Redis命令参数并获取相关的标志（flags）。如果解析失败，它会返回语法错误。
+    argv：命令参数数组。
+    argc：参数数量。
+    start：解析开始的索引。
+    ex_flag：指向标志的指针，用于存储解析后的标志。
+    expire_p、version_p、flags_p、defaultvalue_p、min_p、max_p：指向不同参数的指针，用于存储相应的参数值。
+    allow_flags：允许的标志，用于验证解析后的标志是否合法。
+2. 这个函数的主要功能是解析传入的参数数组，并根据参数设置不同的标志。它确保标志的合法性，并处理冲突的标志。在解析过程中，如果发现任何语法错误或冲突，它会立即返回错误码 REDISMODULE_ERR。
+通过这种方式，函数能够有效地解析命令参数，并为后续的命令处理提供所需的标志和参数值。
+
+*/
+int parseAndGetExFlags(RedisModuleString **argv, int argc, int start, int *ex_flag, RedisModuleString **expire_p,
+                       RedisModuleString **version_p, RedisModuleString **flags_p,
+                              RedisModuleString **defaultvalue_p, RedisModuleString **min_p,
+                              RedisModuleString **max_p, unsigned int allow_flags) {
+    // TAIR_STRING_SET_NO_FLAGS 初始值是0，然后如果存在某个标志位，将其和对应位置相与。
+    int j, ex_flags = TAIR_STRING_SET_NO_FLAGS;
+    for (j = start; j < argc; j++) {
+        RedisModuleString *next = (j == argc - 1) ? NULL : argv[j + 1];
+
+        if (!mstringcasecmp(argv[j], "nx")) {
+            // 如果没有设置 则才会进行设置？ 为什么要进行这个判断？ 
+            // 避免exset中重复的参数。【for循环，遍历 EXFalgs 的左右参数。EXFalgs 】
+            if (ex_flags & TAIR_STRING_SET_XX) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_NX;
+        } else if (!mstringcasecmp(argv[j], "xx")) {
+            if (ex_flags & TAIR_STRING_SET_NX) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_XX;
+        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "ex") && next) {
+            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_EX;
+            *expire_p = next;
+            j++;
+        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "exat") && next) {
+            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_EX;
+            ex_flags |= TAIR_STRING_SET_ABS_EXPIRE;
+            *expire_p = next;
+            j++;
+        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "px") && next) {
+            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_PX;
+            *expire_p = next;
+            j++;
+        } else if (expire_p != NULL && !mstringcasecmp(argv[j], "pxat") && next) {
+            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX | TAIR_STRING_SET_KEEPTTL)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_PX;
+            ex_flags |= TAIR_STRING_SET_ABS_EXPIRE;
+            // 时间
+            *expire_p = next;
+            j++;
+        } else if (version_p != NULL && !mstringcasecmp(argv[j], "ver") && next) {
+            if (ex_flags & (TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_VER;
+            // version 
+            *version_p = next;
+            j++;
+        } else if (version_p != NULL && !mstringcasecmp(argv[j], "abs") && next) {
+            if (ex_flags & (TAIR_STRING_SET_WITH_VER | TAIR_STRING_SET_WITH_ABS_VER)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_ABS_VER;
+            *version_p = next;
+            j++;
+        } else if (flags_p != NULL && !mstringcasecmp(argv[j], "flags") && next) {
+            if (ex_flags & TAIR_STRING_SET_WITH_FLAGS) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_FLAGS;
+            *flags_p = next;
+            j++;
+        } else if (defaultvalue_p != NULL && !mstringcasecmp(argv[j], "def") && next) { /* DEF disabled if XX set. */
+            if (ex_flags & TAIR_STRING_SET_WITH_DEF) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_DEF;
+            *defaultvalue_p = next;
+            j++;
+        } else if (min_p != NULL && !mstringcasecmp(argv[j], "min") && next) {
+            if (*min_p != NULL) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_BOUNDARY;
+            *min_p = next;
+            j++;
+        } else if (max_p != NULL && !mstringcasecmp(argv[j], "max") && next) {
+            if (*max_p != NULL) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_WITH_BOUNDARY;
+            *max_p = next;
+            j++;
+        } else if (!mstringcasecmp(argv[j], "nonegative")) {
+            ex_flags |= TAIR_STRING_SET_NONEGATIVE;
+        } else if (!mstringcasecmp(argv[j], "withversion")) {
+            ex_flags |= TAIR_STRING_RETURN_WITH_VER;
+        } else if (!mstringcasecmp(argv[j], "keepttl")) {
+            // 不能和 nx xx 一起使用。
+            if (ex_flags & (TAIR_STRING_SET_PX | TAIR_STRING_SET_EX)) {
+                return REDISMODULE_ERR;
+            }
+            ex_flags |= TAIR_STRING_SET_KEEPTTL;
+        } else if (!mstringcasecmp(argv[j], "get")) {
+            ex_flags |= TAIR_STRING_SET_GET;
+        } else {
+            return REDISMODULE_ERR;
+        }
+    }
+    
+if ((~allow_flags) & ex_flags) {
+        return REDISMODULE_ERR;
+    }
+
+    *ex_flag = ex_flags;
+    return REDISMODULE_OK;
+}
+
+int tairStringCountedOptionsEnd(RedisModuleString **argv, int argc, int start) {
+    const char *s;
+    size_t len;
+    long long count;
+
+    if (start >= argc) return -1;
+    s = RedisModule_StringPtrLen(argv[start], &len);
+    if (!m_string2ll(s, len, &count) || count < 0 || count > argc - start - 1) return -1;
+    return start + 1 + (int)count;
+}
+
+int tairStringVersionMatches(int ex_flags, long long version, uint64_t current) {
+    /* Version 0 means no version checking. */
+    return !(ex_flags & TAIR_STRING_SET_WITH_VER && version != 0 && (uint64_t)version != current);
+}
+
+uint64_t tairStringNextVersion(int ex_flags, long long version, uint64_t current) {
+    // 如果有绝对版本，则设置绝对版本，否则版本号+1
+    if (ex_flags & TAIR_STRING_SET_WITH_ABS_VER) {
+        return (uint64_t)version;
+    }
+    return current + 1;
+}
+
+long long tairStringRelativeExpire(int ex_flags, long long expire, long long now_ms) {
+    long long milliseconds;
+
+    if (ex_flags & TAIR_STRING_SET_EX) {
+        expire *= 1000;
+    }
+    if (ex_flags & TAIR_STRING_SET_ABS_EXPIRE) {
+        /* Since the RedisModule_SetExpire interface can only set relative
+        expiration times, here we first convert the absolute time passed
+        in by the user to relative time. */
+        milliseconds = expire - now_ms;
+        if (milliseconds < 0) {
+            /* Time out now. */
+            milliseconds = 0;
+        }
+    } else {
+        milliseconds = expire;
+    }
+    return milliseconds;
+}
+
+int tairStringIncrBy(long long value, long long incr, const long long *min, const long long *max, long long *result) {
+    /* Check overflow. */
+    if ((incr < 0 && value < 0 && incr < (LLONG_MIN - value)) || (incr > 0 && value > 0 && incr > (LLONG_MAX - value))
+        || (max != NULL && value + incr > *max) || (min != NULL && value + incr < *min)) {
+        return REDISMODULE_ERR;
+    }
+    *result = value + incr;
+    return REDISMODULE_OK;
+}
+
+int tairStringIncrByFloat(long double value, long double incr, const long double *min, const long double *max,
+                          long double *result) {
+    long double newvalue = value + incr;
+    if (isnan(newvalue) || isinf(newvalue) || (max != NULL && newvalue > *max) || (min != NULL && newvalue < *min)) {
+        return REDISMODULE_ERR;
+    }
+    *result = newvalue;
+    return REDISMODULE_OK;
+}
+
+int tairStringEncodeFloat(char *buf, size_t len, long double value) { return m_ld2string(buf, len, value, 1); }
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 Alibaba Tair Team
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The parts of the TairString commands that do not touch the keyspace: option
+ * parsing, version and expire decisions, overflow and boundary checks and
+ * value encoding. They are built as the tairstring_core static library, so
+ * that they can be benchmarked and profiled in-process (see bench/) as well as
+ * linked into tairstring_module.so.
+ *
+ * This header deliberately does not include redismodule.h: that header
+ * defines every RedisModule_* function pointer, and only one translation unit
+ * per binary may do so (tairstring.c in the module, the shim in bench/). The
+ * few API pointers used here are declared extern below. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef REDISMODULE_OK
+#define REDISMODULE_OK 0
+#define REDISMODULE_ERR 1
+#endif
+
+struct RedisModuleString;
+
+extern const char *(*RedisModule_StringPtrLen)(const struct RedisModuleString *str, size_t *len);
+
+// 没有额外的参数。 不存在  存在   过期时间
+// 版本。
+#define TAIR_STRING_SET_NO_FLAGS 0
+#define TAIR_STRING_SET_NX (1 << 0)
+#define TAIR_STRING_SET_XX (1 << 1)
+#define TAIR_STRING_SET_EX (1 << 2)
+#define TAIR_STRING_SET_PX (1 << 3)
+#define TAIR_STRING_SET_ABS_EXPIRE (1 << 4)
+#define TAIR_STRING_SET_WITH_VER (1 << 5)
+#define TAIR_STRING_SET_WITH_ABS_VER (1 << 6)
+#define TAIR_STRING_SET_WITH_BOUNDARY (1 << 7)
+#define TAIR_STRING_SET_WITH_FLAGS (1 << 8)
+#define TAIR_STRING_SET_WITH_DEF (1 << 9)
+#define TAIR_STRING_SET_NONEGATIVE (1 << 10)
+#define TAIR_STRING_RETURN_WITH_VER (1 << 11)
+#define TAIR_STRING_SET_KEEPTTL (1 << 12)
+#define TAIR_STRING_SET_GET (1 << 13)
+
+int mstring2ld(struct RedisModuleString *val, long double *r_val);
+int mstringcasecmp(const struct RedisModuleString *rs1, const char *s2);
+
+int parseAndGetExFlags(struct RedisModuleString **argv, int argc, int start, int *ex_flag,
+                       struct RedisModuleString **expire_p, struct RedisModuleString **version_p,
+                       struct RedisModuleString **flags_p, struct RedisModuleString **defaultvalue_p,
+                       struct RedisModuleString **min_p, struct RedisModuleString **max_p, unsigned int allow_flags);
+
+/* argv[start] counts the option arguments that follow it. Returns the index
+ * past them, or -1 if the count is not a non-negative integer or runs past
+ * argc. The multi-key commands prefix the options of each key with such a
+ * count, so a key or value spelled like an option is never read as one. */
+int tairStringCountedOptionsEnd(struct RedisModuleString **argv, int argc, int start);
+
+/* Version 0 means no version checking. Returns 1 if a write carrying
+ * VER 'version' may be applied to a value whose version is 'current'. */
+int tairStringVersionMatches(int ex_flags, long long version, uint64_t current);
+
+/* The version a value gets after a successful write: ABS sets it, anything
+ * else bumps it. */
+uint64_t tairStringNextVersion(int ex_flags, long long version, uint64_t current);
+
+/* Convert the EX/EXAT/PX/PXAT argument into the relative milliseconds passed
+ * to RedisModule_SetExpire(). Absolute times in the past expire right away. */
+long long tairStringRelativeExpire(int ex_flags, long long expire, long long now_ms);
+
+/* value + incr, failing with REDISMODULE_ERR on long long overflow or when
+ * the result is out of [*min, *max]. NULL bounds are not checked. */
+int tairStringIncrBy(long long value, long long incr, const long long *min, const long long *max, long long *result);
+
+/* Same as tairStringIncrBy() for EXINCRBYFLOAT, NaN and infinite results are
+ * rejected as overflow. */
+int tairStringIncrByFloat(long double value, long double incr, const long double *min, const long double *max,
+                          long double *result);
+
+/* Encode a float counter the way EXINCRBYFLOAT stores it. Returns the length
+ * written into 'buf', or 0 if it does not fit. */
+int tairStringEncodeFloat(char *buf, size_t len, long double value);
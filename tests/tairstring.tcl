@@ -185,6 +185,61 @@ start_server {tags {"ex_string"} overrides {bind 0.0.0.0}} {
         assert {$ttl > 0 && $ttl <= 10}
     }
 
+    test {exset GET} {
+        r del exstringkey
+
+        set ret_val [r exset exstringkey foo GET]
+        assert_equal "{} 1" $ret_val
+
+        set ret_val [r exset exstringkey bar GET]
+        assert_equal "{foo 1} 2" $ret_val
+
+        set ret_val [r exset exstringkey baz VER 2 FLAGS 3 get]
+        assert_equal "{bar 2} 3" $ret_val
+
+        set ret_val [r exget exstringkey WITHFLAGS]
+        assert_equal "baz 3 3" $ret_val
+
+        catch {r exset exstringkey qux VER 2 GET} err
+        assert_match {*ERR*update*version*is*stale*} $err
+
+        set ret_val [r exget exstringkey]
+        assert_equal "baz 3" $ret_val
+
+        set ret_val [r exset exstringkey qux ABS 10 EX 100 GET]
+        assert_equal "{baz 3} 10" $ret_val
+
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 100}
+
+        r del exstringkey
+        set ret_val [r exset exstringkey foo XX GET]
+        assert_equal "" $ret_val
+
+        r set nativekey foo
+        catch {r exset nativekey foo GET} err
+        assert_match {*WRONGTYPE*} $err
+    }
+
+    test {exset NX GET} {
+        r del exstringkey
+
+        set ret_val [r exset exstringkey foo NX GET EX 100]
+        assert_equal "{} 1" $ret_val
+
+        set ret_val [r exset exstringkey bar NX GET]
+        assert_equal "{foo 1} {}" $ret_val
+
+        set ret_val [r exset exstringkey bar GET NX ABS 10]
+        assert_equal "{foo 1} {}" $ret_val
+
+        set ret_val [r exget exstringkey]
+        assert_equal "foo 1" $ret_val
+
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 100}
+    }
+
     test {unsupported flags} {
         r del exstringkey
 
@@ -496,6 +551,24 @@ start_server {tags {"ex_string"} overrides {bind 0.0.0.0}} {
         assert_equal $res "foobar 2"
     }   
 
+    test {exappend after exset in one script} {
+        r del exstringkey
+
+        # The propagated EXSET must not share the stored value, which EXAPPEND
+        # then appends to in place.
+        set res [r eval {redis.call('exset', KEYS[1], ARGV[1]); return redis.call('exappend', KEYS[1], ARGV[2])} 1 exstringkey foo bar]
+        assert_equal $res 2
+        assert_equal {foobar 2} [r exget exstringkey]
+
+        set res [r eval {redis.call('exmset', KEYS[1], ARGV[1], 0); return redis.call('exappend', KEYS[1], ARGV[2])} 1 exstringkey foo bar]
+        assert_equal $res 4
+        assert_equal {foobar 4} [r exget exstringkey]
+
+        set res [r eval {redis.call('extxn', 'THEN', 'SET', KEYS[1], ARGV[1], 0); return redis.call('exappend', KEYS[1], ARGV[2])} 1 exstringkey foo bar]
+        assert_equal $res 6
+        assert_equal {foobar 6} [r exget exstringkey]
+    }
+
     test {exappend ver/abs} {
         r del exstringkey
 
@@ -650,6 +723,152 @@ start_server {tags {"ex_string"} overrides {bind 0.0.0.0}} {
         assert_equal $res 1
     }
 
+    test {exgetrange/exsetrange} {
+        r del exstringkey stringkey
+
+        catch {r exgetrange exstringkey 0} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exgetrange exstringkey a 1} err
+        assert_match {*ERR*not*an*integer*} $err
+
+        catch {r exsetrange exstringkey -1 foo} err
+        assert_match {*ERR*offset*out*of*range*} $err
+
+        catch {r exsetrange exstringkey 536870912 foo} err
+        assert_match {*ERR*maximum*allowed*size*} $err
+
+        catch {r exsetrange exstringkey 0 foo EX 10} err
+        assert_match {*ERR*syntax*error*} $err
+
+        assert_equal {} [r exgetrange exstringkey 0 -1]
+        assert_equal {} [r exsetrange exstringkey 0 foo XX]
+        assert_equal 0 [r exsetrange exstringkey 5 ""]
+        assert_equal 0 [r exists exstringkey]
+
+        set res [r exsetrange exstringkey 3 bar]
+        assert_equal 1 $res
+        assert_equal "\x00\x00\x00bar 1" [r exget exstringkey]
+
+        r exset exstringkey "hello world" EX 100 FLAGS 7
+        assert_equal {hello 1} [r exgetrange exstringkey 0 4]
+        assert_equal {world 1} [r exgetrange exstringkey -5 -1]
+        assert_equal {{hello world} 1} [r exgetrange exstringkey -100 100]
+        assert_equal {{} 1} [r exgetrange exstringkey 5 4]
+
+        assert_equal 2 [r exsetrange exstringkey 6 redis VER 1]
+        assert_equal {{hello redis} 2 7} [r exget exstringkey WITHFLAGS]
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 100}
+
+        catch {r exsetrange exstringkey 0 HELLO VER 1} err
+        assert_match {*ERR*update*version*is*stale*} $err
+        assert_equal {{hello redis} 2} [r exget exstringkey]
+
+        assert_equal 10 [r exsetrange exstringkey 11 ! ABS 10]
+        assert_equal {{hello redis!} 10} [r exget exstringkey]
+
+        assert_equal 11 [r exsetrange exstringkey 1 EL]
+        assert_equal {{hELlo redis!} 11} [r exget exstringkey]
+
+        assert_equal 12 [r exsetrange exstringkey 5000 x]
+        assert_equal 5001 [string length [lindex [r exget exstringkey] 0]]
+        assert_equal "!\x00\x00" [lindex [r exgetrange exstringkey 11 13] 0]
+
+        assert_equal {} [r exsetrange exstringkey 0 x NX]
+
+        r set stringkey bar
+        catch {r exsetrange stringkey 0 foo} err
+        assert_match {*WRONGTYPE*} $err
+        catch {r exgetrange stringkey 0 1} err
+        assert_match {*WRONGTYPE*} $err
+    }
+
+    test {exupbegin/exupappend/exupcommit} {
+        r del exstringkey uploadkey stringkey
+
+        catch {r exupappend uploadkey foo} err
+        assert_match {*ERR*no*such*upload*session*} $err
+
+        catch {r exupcommit uploadkey exstringkey} err
+        assert_match {*ERR*no*such*upload*session*} $err
+
+        catch {r exupbegin uploadkey EX 0} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exupbegin uploadkey VER 1} err
+        assert_match {*ERR*syntax*error*} $err
+
+        assert_equal OK [r exupbegin uploadkey]
+        set ttl [r ttl uploadkey]
+        assert {$ttl > 3500 && $ttl <= 3600}
+        assert_equal {} [r exupbegin uploadkey EX 100]
+
+        assert_equal 3 [r exupappend uploadkey foo]
+        assert_equal 6 [r exupappend uploadkey bar]
+        assert_equal 6 [r exupappend uploadkey ""]
+
+        catch {r exupcommit uploadkey uploadkey} err
+        assert_match {*ERR*syntax*error*} $err
+
+        r exset exstringkey old EX 100
+        catch {r exupcommit uploadkey exstringkey VER 2} err
+        assert_match {*ERR*update*version*is*stale*} $err
+        assert_equal {} [r exupcommit uploadkey exstringkey NX]
+        assert_equal {old 1} [r exget exstringkey]
+        assert_equal 1 [r exists uploadkey]
+
+        assert_equal 2 [r exupcommit uploadkey exstringkey VER 1 KEEPTTL FLAGS 5]
+        assert_equal {foobar 2 5} [r exget exstringkey WITHFLAGS]
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal 0 [r exists uploadkey]
+
+        # An abandoned upload expires.
+        r exupbegin uploadkey PX 100
+        r exupappend uploadkey foo
+        after 200
+        assert_equal 0 [r exists uploadkey]
+
+        r set stringkey bar
+        catch {r exupappend stringkey foo} err
+        assert_match {*WRONGTYPE*} $err
+        r exupbegin uploadkey
+        catch {r exupcommit uploadkey stringkey} err
+        assert_match {*WRONGTYPE*} $err
+
+        # Only sessions of EXUPBEGIN are uploads, and they are not exstrtype.
+        assert_equal exupltype [r type uploadkey]
+        catch {r exget uploadkey} err
+        assert_match {*WRONGTYPE*} $err
+        r exset exstringkey foo
+        catch {r exupappend exstringkey bar} err
+        assert_match {*WRONGTYPE*} $err
+        catch {r exupcommit exstringkey stringkey} err
+        assert_match {*WRONGTYPE*} $err
+        r multi
+        r exset exstringkey foo
+        r exupappend exstringkey bar
+        set res [r exec]
+        assert_match {OK *WRONGTYPE*} $res
+        assert_equal {foo 4} [r exget exstringkey]
+
+        # A session survives a reload and an AOF rewrite.
+        r del uploadkey
+        r exupbegin uploadkey EX 100
+        r exupappend uploadkey foo
+        r debug reload
+        assert_equal 6 [r exupappend uploadkey bar]
+        r config set aof-use-rdb-preamble no
+        r bgrewriteaof
+        waitForBgrewriteaof r
+        r debug loadaof
+        set ttl [r ttl uploadkey]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal 5 [r exupcommit uploadkey exstringkey]
+        assert_equal {foobar 5} [r exget exstringkey]
+    }
+
     test {exgae} {
         r del exstringkey
 
@@ -999,6 +1218,52 @@ start_server {tags {"ex_string"} overrides {bind 0.0.0.0}} {
         assert_equal $res "" 
     }
 
+    test {excas novalue/withvalue ifsmaller} {
+        r del exstringkey
+
+        r exset exstringkey bar
+        r exset exstringkey bar1
+
+        set res [r excas exstringkey foo 1]
+        assert_equal $res "CAS_FAILED bar1 2"
+
+        set res [r excas exstringkey foo 1 NOVALUE]
+        assert_equal $res "CAS_FAILED {} 2"
+
+        set res [r excas exstringkey foo 1 WITHVALUE IFSMALLER 4]
+        assert_equal $res "CAS_FAILED {} 2"
+
+        set res [r excas exstringkey foo 1 EX 100 WITHVALUE IFSMALLER 5]
+        assert_equal $res "CAS_FAILED bar1 2"
+        assert_equal -1 [r ttl exstringkey]
+
+        catch {r excas exstringkey foo 1 NOVALUE WITHVALUE IFSMALLER 5} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r excas exstringkey foo 1 WITHVALUE IFSMALLER abc} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r excas exstringkey foo 1 WITHVALUE} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r excas exstringkey foo 1 EX NOVALUE} err
+        assert_match {*ERR*syntax*error*} $err
+
+        set res [r excas exstringkey novalue 1]
+        assert_equal $res "CAS_FAILED bar1 2"
+
+        set res [r excas exstringkey ex 2 NOVALUE]
+        assert_equal $res "OK {} 3"
+        assert_equal "ex 3" [r exget exstringkey]
+
+        catch {r excas exstringkey foo 3 NOVALUE EX 100} err
+        assert_match {*ERR*syntax*error*} $err
+
+        set res [r excas exstringkey foo 3 KEEPTTL NOVALUE]
+        assert_equal $res "OK {} 4"
+        assert_equal {foo 4} [r exget exstringkey]
+    }
+
     test {excad test works} {
         r del exstringkey
 
@@ -1105,6 +1370,575 @@ start_server {tags {"ex_string"} overrides {bind 0.0.0.0}} {
         assert_equal "OK" [r restore exstringkey 0 $dump]
         assert_equal {bar 1} [r exget exstringkey]
     }
+
+    test {exget ifnewer} {
+        r del exstringkey stringkey
+
+        catch {r exget exstringkey IFNEWER} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exget exstringkey IFNEWER abc} err
+        assert_match {*ERR*version*should*be*integer*} $err
+
+        catch {r exget exstringkey IFNEWER 1 NX} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exget exstringkey IFNEWER 1 WITHFLAGS NX} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        assert_equal {} [r exget exstringkey IFNEWER 1]
+
+        r exset exstringkey foo FLAGS 7
+        assert_equal NOT_MODIFIED [r exget exstringkey IFNEWER 1]
+        assert_equal NOT_MODIFIED [r exget exstringkey WITHFLAGS IFNEWER 1]
+        assert_equal {foo 1} [r exget exstringkey IFNEWER 0]
+
+        r exset exstringkey bar KEEPTTL
+        assert_equal {bar 2} [r exget exstringkey IFNEWER 1]
+        assert_equal {bar 2 7} [r exget exstringkey IFNEWER 1 WITHFLAGS]
+
+        # A key recreated with a lower version is modified too.
+        r exset exstringkey baz ABS 1
+        assert_equal {baz 1} [r exget exstringkey ifnewer 2]
+
+        r set stringkey bar
+        catch {r exget stringkey IFNEWER 1} err
+        assert_match {*WRONGTYPE*} $err
+    }
+
+    test {exmget} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r exmget} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        r exset exstringkey1 foo
+        r exset exstringkey2 bar ABS 10 FLAGS 7
+        r set stringkey baz
+
+        set res [r exmget exstringkey1]
+        assert_equal $res {{foo 1}}
+
+        set res [r exmget exstringkey1 exstringkey3 stringkey exstringkey2]
+        assert_equal $res {{foo 1} {} {} {bar 10}}
+
+        set res [r exmget exstringkey1 exstringkey2 WITHFLAGS]
+        assert_equal $res {{foo 1 0} {bar 10 7}}
+
+        set res [r exmget withflags]
+        assert_equal $res {{}}
+
+        assert_equal {k1 k2} [r command getkeys exmget k1 k2 WITHFLAGS]
+        catch {r command getkeys exmget} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {exgetver} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r exgetver} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exgetver exstringkey1 WITHFLAGS} err
+        assert_match {*ERR*syntax*error*} $err
+
+        assert_equal {} [r exgetver exstringkey1]
+
+        r exset exstringkey1 foo
+        r exset exstringkey2 bar ABS 10 FLAGS 7 PX 100000
+        r set stringkey baz
+
+        assert_equal {1 0} [r exgetver exstringkey1]
+        assert_equal {1 0 -1} [r exgetver exstringkey1 WITHTTL]
+        set res [r exgetver exstringkey2 WITHTTL]
+        assert_equal {10 7} [lrange $res 0 1]
+        set pttl [lindex $res 2]
+        assert {$pttl > 0 && $pttl <= 100000}
+
+        catch {r exgetver stringkey} err
+        assert_match {*WRONGTYPE*} $err
+
+        catch {r exmgetver} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        set res [r exmgetver exstringkey1 exstringkey3 stringkey exstringkey2]
+        assert_equal $res {{1 0} {} {} {10 7}}
+
+        set res [r exmgetver exstringkey1 WITHTTL]
+        assert_equal $res {{1 0 -1}}
+
+        set res [r exmgetver withttl]
+        assert_equal $res {{}}
+
+        assert_equal {k1 k2} [r command getkeys exmgetver k1 k2 WITHTTL]
+        catch {r command getkeys exmgetver} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {exmset} {
+        r del exstringkey1 exstringkey2 stringkey
+
+        catch {r exmset exstringkey1} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmset exstringkey1 foo 0 exstringkey2 bar} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmset exstringkey1 foo 2 EX} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmset exstringkey1 foo EX 10} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmset exstringkey1 foo 1 WITHVERSION} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmset exstringkey1 foo 2 EX 0} err
+        assert_match {*ERR*syntax*error*} $err
+
+        set res [r exmset exstringkey1 foo 0 exstringkey2 bar 4 ABS 10 FLAGS 7]
+        assert_equal $res {1 10}
+        assert_equal {foo 1 0} [r exget exstringkey1 withflags]
+        assert_equal {bar 10 7} [r exget exstringkey2 withflags]
+
+        set res [r exmset exstringkey1 foo1 4 VER 1 EX 100 exstringkey2 bar1 3 VER 10 KEEPTTL]
+        assert_equal $res {2 11}
+        set ttl [r ttl exstringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal -1 [r ttl exstringkey2]
+
+        # A stale version leaves every key untouched.
+        catch {r exmset exstringkey1 foo2 2 VER 2 exstringkey2 bar2 2 VER 1} err
+        assert_match {*ERR*update*version*is*stale*} $err
+        assert_equal {foo1 2} [r exget exstringkey1]
+        assert_equal {bar1 11} [r exget exstringkey2]
+
+        set res [r exmset exstringkey1 foo2 0 exstringkey3 baz 1 XX]
+        assert_equal $res ""
+        assert_equal {foo1 2} [r exget exstringkey1]
+        assert_equal 0 [r exists exstringkey3]
+
+        r set stringkey baz
+        catch {r exmset exstringkey1 foo2 0 stringkey bar2 0} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal {foo1 2} [r exget exstringkey1]
+
+        # A key given twice sees what the first occurrence writes.
+        set res [r exmset exstringkey1 foo2 2 VER 2 exstringkey1 foo3 2 VER 3]
+        assert_equal $res {3 4}
+        assert_equal {foo3 4} [r exget exstringkey1]
+
+        catch {r exmset exstringkey1 foo4 2 VER 4 exstringkey1 foo5 2 VER 4} err
+        assert_match {*ERR*update*version*is*stale*} $err
+        assert_equal {foo3 4} [r exget exstringkey1]
+
+        # Keys and values named like options are not taken for options.
+        r del ex ver
+        set res [r exmset ex ver 0 ver 2 2 FLAGS 3]
+        assert_equal $res {1 1}
+        assert_equal {ver 1} [r exget ex]
+        assert_equal {2 1 3} [r exget ver withflags]
+
+        assert_equal {ex ver} [r command getkeys exmset ex ver 0 ver 2 2 FLAGS 3]
+        assert_equal {k1 k2} [r command getkeys exmset k1 v1 4 EX 10 VER 2 k2 v2 0]
+        # A malformed command has no keys, and does not hang the server.
+        catch {r command getkeys exmset k v bad} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmset k v 3 EX 10} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmset k v 0 k2 v2} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmset k} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {exmincrby} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r exmincrby exstringkey1} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmincrby 0 exstringkey1 1 0 exstringkey2} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmincrby 0 exstringkey1 abc 0} err
+        assert_match {*ERR*value*is*not*an*integer*} $err
+
+        catch {r exmincrby 0 exstringkey1 1 2 VER 1} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmincrby EX 10 exstringkey1 1 0} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmincrby 0 exstringkey1 1 2 EX} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmincrby 4 MIN 10 MAX 0 exstringkey1 1 0} err
+        assert_match {*ERR*min*or*max*} $err
+        assert_equal 0 [r exists exstringkey1]
+
+        set res [r exmincrby 0 exstringkey1 1 0 exstringkey2 10 0 exstringkey1 2 0]
+        assert_equal $res {1 10 3}
+        assert_equal {3 2} [r exget exstringkey1]
+        assert_equal {10 1} [r exget exstringkey2]
+
+        # Shared options, overridden per key.
+        set res [r exmincrby 3 MAX 12 WITHVERSION exstringkey1 5 0 exstringkey2 5 2 MAX 100 exstringkey3 -5 3 DEF 7 NONEGATIVE]
+        assert_equal $res {{8 3} {15 2} {7 1}}
+
+        # A failing key does not stop the others.
+        r exset exstringkey3 foo
+        r set stringkey bar
+        catch {r exmincrby 2 MAX 10 exstringkey1 1 0 exstringkey2 1 0 exstringkey3 1 0 stringkey 1 0} err
+        assert_match {*ERR*overflow*} $err
+        assert_equal {9 4} [r exget exstringkey1]
+        assert_equal {15 2} [r exget exstringkey2]
+        assert_equal {foo 2} [r exget exstringkey3]
+        assert_equal bar [r get stringkey]
+
+        catch {r exmincrby 0 exstringkey1 9223372036854775807 0} err
+        assert_match {*ERR*overflow*} $err
+        assert_equal {9 4} [r exget exstringkey1]
+
+        set res [r exmincrby 2 EX 100 exstringkey1 1 0 exstringkey2 1 1 KEEPTTL]
+        assert_equal $res {10 16}
+        set ttl [r ttl exstringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal -1 [r ttl exstringkey2]
+
+        # Keys named like options are not taken for options.
+        r del max def
+        set res [r exmincrby 0 max 1 0 def 2 2 DEF 5]
+        assert_equal $res {1 7}
+
+        assert_equal {max def} [r command getkeys exmincrby 0 max 1 0 def 2 2 DEF 5]
+        assert_equal {k1 k2} [r command getkeys exmincrby 2 MAX 10 k1 1 0 k2 2 1 KEEPTTL]
+        catch {r command getkeys exmincrby MAX 10 k1 1 0} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmincrby 0 k1 1 0 k2 1} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmincrby 0 k1 1 2 MAX} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys exmincrby 5} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {extxn} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r extxn} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r extxn VERSION exstringkey1 == 1} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r extxn VERSION exstringkey1 >= 1 THEN} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r extxn VERSION exstringkey1 == abc THEN} err
+        assert_match {*ERR*version*should*be*integer*} $err
+
+        catch {r extxn THEN SET exstringkey1 foo 1 NX} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r extxn THEN SET exstringkey1 foo EX 10} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r extxn THEN SET exstringkey1 foo 2 EX} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r extxn THEN INCRBY exstringkey1 abc 0} err
+        assert_match {*ERR*value*is*not*an*integer*} $err
+
+        catch {r extxn THEN GET exstringkey1 ELSE GET exstringkey1 ELSE} err
+        assert_match {*ERR*syntax*error*} $err
+
+        set res [r extxn NOTEXISTS exstringkey1 THEN SET exstringkey1 foo 0 INCRBY exstringkey2 5 0 ELSE GET exstringkey1]
+        assert_equal $res {1 {1 5}}
+        assert_equal {foo 1} [r exget exstringkey1]
+        assert_equal {5 1} [r exget exstringkey2]
+
+        set res [r extxn VERSION exstringkey1 == 1 VALUE exstringkey1 == foo THEN SET exstringkey1 bar 2 EX 100 GET exstringkey1 ELSE GET exstringkey1]
+        assert_equal $res {1 {2 {bar 2}}}
+        set ttl [r ttl exstringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+
+        set res [r extxn VERSION exstringkey1 == 1 THEN SET exstringkey1 baz 0 ELSE GET exstringkey1 DEL exstringkey2]
+        assert_equal $res {0 {{bar 2} 1}}
+        assert_equal {bar 2} [r exget exstringkey1]
+        assert_equal 0 [r exists exstringkey2]
+
+        # A missing key has version 0 and no value.
+        set res [r extxn VALUE exstringkey3 != x VERSION exstringkey2 < 1 THEN INCRBY exstringkey3 1 3 DEF 10 WITHVERSION]
+        assert_equal $res {1 {{10 1}}}
+        set res [r extxn VALUE exstringkey2 == x THEN DEL exstringkey1 ELSE SET exstringkey2 v 4 ABS 7 FLAGS 3]
+        assert_equal $res {0 7}
+        assert_equal {v 7 3} [r exget exstringkey2 WITHFLAGS]
+
+        # An operation that would fail changes nothing.
+        catch {r extxn THEN SET exstringkey1 x 0 INCRBY exstringkey1 1 0} err
+        assert_match {*ERR*value*is*not*an*integer*} $err
+        assert_equal {bar 2} [r exget exstringkey1]
+
+        catch {r extxn THEN DEL exstringkey1 INCRBY exstringkey3 1 2 MAX 10} err
+        assert_match {*ERR*overflow*} $err
+        assert_equal {bar 2} [r exget exstringkey1]
+        assert_equal {10 1} [r exget exstringkey3]
+
+        r set stringkey bar
+        catch {r extxn VERSION stringkey == 0 THEN} err
+        assert_match {*WRONGTYPE*} $err
+        catch {r extxn EXISTS stringkey THEN SET stringkey foo 0} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal bar [r get stringkey]
+        assert_equal {1 {}} [r extxn EXISTS stringkey THEN]
+
+        # Values named like options or operations are not taken for them.
+        r del ex
+        set res [r extxn THEN SET ex get 0 SET ex else 2 FLAGS 1 GET ex]
+        assert_equal $res {1 {1 2 {else 2}}}
+
+        assert_equal {k1 k2 k3 k4 k1} [r command getkeys extxn VERSION k1 == 1 EXISTS k2 THEN SET k3 v 2 EX 10 ELSE INCRBY k4 1 0 DEL k1]
+        catch {r command getkeys extxn THEN SET k1 v EX 10} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys extxn VERSION k1 == 1} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys extxn} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {exmcad} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r exmcad exstringkey1} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmcad exstringkey1 1 exstringkey2} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        r exset exstringkey1 foo
+        r exset exstringkey2 bar ABS 5
+        catch {r exmcad exstringkey1 1 exstringkey2 abc} err
+        assert_match {*ERR*syntax*error*} $err
+        assert_equal 1 [r exists exstringkey1]
+
+        set res [r exmcad exstringkey1 1 exstringkey2 4 exstringkey3 1 exstringkey1 1]
+        assert_equal $res {1 0 -1 -1}
+        assert_equal 0 [r exists exstringkey1]
+        assert_equal {bar 5} [r exget exstringkey2]
+
+        # A key of another type does not stop the others.
+        r set stringkey bar
+        catch {r exmcad stringkey 1 exstringkey2 5} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal bar [r get stringkey]
+        assert_equal 0 [r exists exstringkey2]
+    }
+
+    test {exmgae} {
+        r del exstringkey1 exstringkey2 exstringkey3 stringkey
+
+        catch {r exmgae EX 100 exstringkey1} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmgae EX 100 exstringkey1 1 exstringkey2} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exmgae NX 100 exstringkey1 1} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exmgae EX 0 exstringkey1 1} err
+        assert_match {*ERR*syntax*error*} $err
+
+        r exset exstringkey1 foo
+        r exset exstringkey2 bar ABS 5
+        catch {r exmgae EX 100 exstringkey1 1 exstringkey2 abc} err
+        assert_match {*ERR*syntax*error*} $err
+        assert_equal -1 [r ttl exstringkey1]
+
+        set res [r exmgae EX 100 exstringkey1 1 exstringkey2 4 exstringkey3 1]
+        assert_equal $res {1 0 -1}
+        set ttl [r ttl exstringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal -1 [r ttl exstringkey2]
+        assert_equal {foo 1} [r exget exstringkey1]
+
+        # A key of another type does not stop the others.
+        r set stringkey bar
+        catch {r exmgae PX 100000 stringkey 1 exstringkey2 5} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal -1 [r ttl stringkey]
+        set ttl [r ttl exstringkey2]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal {bar 5} [r exget exstringkey2]
+    }
+
+    test {exgetex} {
+        r del exstringkey stringkey
+
+        catch {r exgetex exstringkey EX} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r exgetex exstringkey EXAT 100} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exgetex exstringkey EX 0} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exgetex exstringkey EX 100 BELOW 200} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r exgetex exstringkey BELOW 10 EX 100} err
+        assert_match {*ERR*syntax*error*} $err
+
+        assert_equal {} [r exgetex exstringkey]
+        assert_equal {} [r exgetex exstringkey EX 100]
+
+        r exset exstringkey foo FLAGS 3
+        assert_equal {foo 1 3 -1} [r exgetex exstringkey]
+
+        # A key without expire is never below the threshold.
+        assert_equal {foo 1 3 -1} [r exgetex exstringkey EX 100 BELOW 50]
+        assert_equal -1 [r ttl exstringkey]
+
+        set res [r exgetex exstringkey PX 100000]
+        assert_equal {foo 1 3 100000} $res
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 100}
+
+        # Above the threshold the TTL is left as it is.
+        r pexpire exstringkey 80000
+        set res [r exgetex exstringkey EX 100 BELOW 50]
+        set pttl [lindex $res 3]
+        assert {$pttl > 0 && $pttl <= 80000}
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 0 && $ttl <= 80}
+
+        r pexpire exstringkey 20000
+        set res [r exgetex exstringkey ex 100 below 50]
+        assert_equal {foo 1 3 100000} $res
+        set ttl [r ttl exstringkey]
+        assert {$ttl > 80 && $ttl <= 100}
+
+        r set stringkey bar
+        catch {r exgetex stringkey} err
+        assert_match {*WRONGTYPE*} $err
+    }
+
+    test {mcas} {
+        r del stringkey1 stringkey2 stringkey3 exstringkey
+
+        catch {r mcas 1 stringkey1 foo} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r mcas 2 stringkey1 foo bar stringkey2} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r mcas ATOMIC stringkey1 foo bar} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r mcas 1 stringkey1 foo bar EX 0} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r mcas 1 stringkey1 foo bar stringkey2} err
+        assert_match {*ERR*syntax*error*} $err
+
+        r set stringkey1 foo
+        r set stringkey2 bar
+        set res [r mcas 3 stringkey1 foo foo1 stringkey2 xxx bar1 stringkey3 foo bar]
+        assert_equal $res {1 0 -1}
+        assert_equal foo1 [r get stringkey1]
+        assert_equal bar [r get stringkey2]
+        assert_equal 0 [r exists stringkey3]
+
+        # ATOMIC writes nothing unless every comparison passes.
+        set res [r mcas 2 stringkey1 foo1 foo2 stringkey2 xxx bar1 ATOMIC]
+        assert_equal $res {1 0}
+        assert_equal foo1 [r get stringkey1]
+
+        set res [r mcas 3 stringkey1 foo1 foo2 stringkey2 bar bar1 stringkey1 foo2 foo3 ATOMIC EX 100]
+        assert_equal $res {1 1 1}
+        assert_equal foo3 [r get stringkey1]
+        assert_equal bar1 [r get stringkey2]
+        set ttl [r ttl stringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+
+        set res [r mcas 2 stringkey1 foo3 foo4 stringkey2 bar1 bar2 KEEPTTL]
+        assert_equal $res {1 1}
+        set ttl [r ttl stringkey1]
+        assert {$ttl > 0 && $ttl <= 100}
+        assert_equal -1 [r ttl stringkey2]
+
+        r exset exstringkey foo
+        catch {r mcas 2 stringkey1 foo4 foo5 exstringkey foo bar} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal foo5 [r get stringkey1]
+
+        catch {r mcas 2 stringkey1 foo5 foo6 exstringkey foo bar ATOMIC} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal foo5 [r get stringkey1]
+
+        # Keys named like options are keys.
+        r del atomic ex
+        r set atomic foo
+        set res [r mcas 2 atomic foo bar ex foo bar]
+        assert_equal $res {1 -1}
+        assert_equal bar [r get atomic]
+
+        assert_equal {atomic ex} [r command getkeys mcas 2 atomic foo bar ex foo bar ATOMIC EX 10]
+        catch {r command getkeys mcas ATOMIC k1 a b} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys mcas 2 k1 a b k2} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys mcas} err
+        assert_match {*Invalid*arguments*} $err
+    }
+
+    test {mcad} {
+        r del stringkey1 stringkey2 stringkey3 exstringkey
+
+        catch {r mcad 1 stringkey1} err
+        assert_match {*ERR*wrong*number*of*arguments*} $err
+
+        catch {r mcad 2 stringkey1 foo stringkey2} err
+        assert_match {*ERR*syntax*error*} $err
+
+        catch {r mcad 1 stringkey1 foo stringkey2} err
+        assert_match {*ERR*syntax*error*} $err
+
+        r set stringkey1 foo
+        r set stringkey2 bar
+        set res [r mcad 3 stringkey1 foo stringkey2 xxx stringkey3 foo ATOMIC]
+        assert_equal $res {1 0 -1}
+        assert_equal 1 [r exists stringkey1]
+
+        set res [r mcad 3 stringkey1 foo stringkey2 xxx stringkey3 foo]
+        assert_equal $res {1 0 -1}
+        assert_equal 0 [r exists stringkey1]
+        assert_equal bar [r get stringkey2]
+
+        r exset exstringkey foo
+        catch {r mcad 2 stringkey2 bar exstringkey foo ATOMIC} err
+        assert_match {*WRONGTYPE*} $err
+        assert_equal bar [r get stringkey2]
+
+        set res [r mcad 1 stringkey2 bar ATOMIC]
+        assert_equal $res {1}
+        assert_equal 0 [r exists stringkey2]
+
+        r set atomic foo
+        set res [r mcad 1 atomic foo]
+        assert_equal $res {1}
+        assert_equal 0 [r exists atomic]
+
+        assert_equal {atomic k2} [r command getkeys mcad 2 atomic foo k2 bar ATOMIC]
+        catch {r command getkeys mcad 0 k1 a} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys mcad 2 k1 a k2} err
+        assert_match {*Invalid*arguments*} $err
+        catch {r command getkeys mcad} err
+        assert_match {*Invalid*arguments*} $err
+    }
 }
 
 start_server {tags {"exhash repl"} overrides {bind 0.0.0.0}} {
@@ -1244,6 +2078,40 @@ start_server {tags {"exhash repl"} overrides {bind 0.0.0.0}} {
             assert_equal $res "gaofoobar 3"
         }
 
+        test {exsetrange master-slave} {
+            $master del exstringkey
+
+            $master exset exstringkey "hello world"
+            assert_equal 2 [$master exsetrange exstringkey 6 redis VER 1]
+            assert_equal 3 [$master exsetrange exstringkey 13 ! XX]
+
+            $master WAIT 1 5000
+
+            assert_equal "hello redis\x00\x00! 3" [$slave exget exstringkey]
+        }
+
+        test {exupload master-slave} {
+            $master del exstringkey uploadkey
+
+            $master exupbegin uploadkey EX 100
+            $master exupappend uploadkey foo
+            $master exupappend uploadkey bar
+
+            $master WAIT 1 5000
+
+            set ttl [$slave ttl uploadkey]
+            assert {$ttl > 0 && $ttl <= 100}
+
+            assert_equal 10 [$master exupcommit uploadkey exstringkey ABS 10 EX 100]
+
+            $master WAIT 1 5000
+
+            assert_equal {foobar 10} [$slave exget exstringkey]
+            set ttl [$slave ttl exstringkey]
+            assert {$ttl > 0 && $ttl <= 100}
+            assert_equal 0 [$slave exists uploadkey]
+        }
+
         test {exgae master-slave} {
             $master del exstringkey
 
@@ -1395,6 +2263,131 @@ start_server {tags {"exhash repl"} overrides {bind 0.0.0.0}} {
             assert_equal $res ""
         }
         
+        test {exmset master-slave} {
+            $master del exstringkey1 exstringkey2
+
+            set res [$master exmset exstringkey1 foo 2 EX 100 exstringkey2 bar 4 ABS 10 FLAGS 7]
+            assert_equal $res {1 10}
+
+            set res [$master exmset exstringkey1 foo1 3 VER 1 KEEPTTL exstringkey2 bar1 2 VER 10]
+            assert_equal $res {2 11}
+
+            $master WAIT 1 5000
+
+            assert_equal {foo1 2 0} [$slave exget exstringkey1 WITHFLAGS]
+            assert_equal {bar1 11 7} [$slave exget exstringkey2 WITHFLAGS]
+            set ttl [$slave ttl exstringkey1]
+            assert {$ttl > 0 && $ttl <= 100}
+            assert_equal -1 [$slave ttl exstringkey2]
+        }
+
+        test {exmincrby master-slave} {
+            $master del exstringkey1 exstringkey2
+
+            $master exset exstringkey2 foo FLAGS 7
+            catch {$master exmincrby 2 MIN 0 exstringkey1 10 2 EX 100 exstringkey2 1 0 exstringkey1 -20 0 exstringkey1 5 0} err
+            assert_match {*ERR*value*is*not*an*integer*} $err
+            assert_equal {15 2} [$master exget exstringkey1]
+
+            $master WAIT 1 5000
+
+            assert_equal {15 2} [$slave exget exstringkey1]
+            assert_equal -1 [$slave ttl exstringkey1]
+            assert_equal {foo 1 7} [$slave exget exstringkey2 WITHFLAGS]
+        }
+
+        test {extxn master-slave} {
+            $master del exstringkey1 exstringkey2 exstringkey3
+
+            $master exset exstringkey1 foo
+            set res [$master extxn VALUE exstringkey1 == foo THEN SET exstringkey1 bar 6 ABS 10 EX 100 FLAGS 5 INCRBY exstringkey2 3 1 WITHVERSION SET exstringkey3 tmp 0 DEL exstringkey3]
+            assert_equal $res {1 {10 {3 1} 1 1}}
+
+            $master WAIT 1 5000
+
+            assert_equal {bar 10 5} [$slave exget exstringkey1 WITHFLAGS]
+            set ttl [$slave ttl exstringkey1]
+            assert {$ttl > 0 && $ttl <= 100}
+            assert_equal {3 1} [$slave exget exstringkey2]
+            assert_equal 0 [$slave exists exstringkey3]
+        }
+
+        test {exmcad master-slave} {
+            $master del exstringkey1 exstringkey2 exstringkey3
+
+            $master exset exstringkey1 foo
+            $master exset exstringkey2 bar
+            $master exset exstringkey3 baz ABS 3
+            set res [$master exmcad exstringkey1 1 exstringkey2 2 exstringkey3 3]
+            assert_equal $res {1 0 1}
+
+            $master WAIT 1 5000
+
+            assert_equal 0 [$slave exists exstringkey1]
+            assert_equal {bar 1} [$slave exget exstringkey2]
+            assert_equal 0 [$slave exists exstringkey3]
+        }
+
+        test {exmgae master-slave} {
+            $master del exstringkey1 exstringkey2
+
+            $master exset exstringkey1 foo
+            $master exset exstringkey2 bar
+            set res [$master exmgae EX 100 exstringkey1 1 exstringkey2 2]
+            assert_equal $res {1 0}
+
+            $master WAIT 1 5000
+
+            set ttl [$slave ttl exstringkey1]
+            assert {$ttl > 0 && $ttl <= 100}
+            assert_equal -1 [$slave ttl exstringkey2]
+            assert_equal {foo 1} [$slave exget exstringkey1]
+        }
+
+        test {exgetex master-slave} {
+            $master del exstringkey1 exstringkey2
+
+            $master exset exstringkey1 foo
+            $master exset exstringkey2 bar
+            $master pexpire exstringkey2 80000
+            assert_equal {foo 1 0 -1} [$master exgetex exstringkey1 PX 100000 BELOW 50000]
+            assert_equal {foo 1 0 100000} [$master exgetex exstringkey1 PX 100000]
+            set res [$master exgetex exstringkey2 PX 100000 BELOW 50000]
+            assert {[lindex $res 3] <= 80000}
+
+            $master WAIT 1 5000
+
+            set ttl [$slave ttl exstringkey1]
+            assert {$ttl > 0 && $ttl <= 100}
+            set ttl [$slave ttl exstringkey2]
+            assert {$ttl > 0 && $ttl <= 80}
+            assert_equal {foo 1} [$slave exget exstringkey1]
+        }
+
+        test {mcas/mcad master-slave} {
+            $master del stringkey1 stringkey2 stringkey3
+
+            $master set stringkey1 foo
+            $master set stringkey2 bar
+            $master set stringkey3 baz EX 100
+            set res [$master mcas 2 stringkey1 foo foo1 stringkey2 xxx bar1 EX 100]
+            assert_equal $res {1 0}
+            set res [$master mcas 1 stringkey3 baz baz1 KEEPTTL]
+            assert_equal $res {1}
+            set res [$master mcad 1 stringkey2 bar ATOMIC]
+            assert_equal $res {1}
+
+            $master WAIT 1 5000
+
+            assert_equal foo1 [$slave get stringkey1]
+            set ttl [$slave ttl stringkey1]
+            assert {$ttl > 0 && $ttl <= 100}
+            assert_equal 0 [$slave exists stringkey2]
+            assert_equal baz1 [$slave get stringkey3]
+            set ttl [$slave ttl stringkey3]
+            assert {$ttl > 0 && $ttl <= 100}
+        }
+
         test {exset with flags master-slave} {
             $master del exstringkey
 